@@ -0,0 +1,156 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Selective confirmed uplinks. Only uplinks worth an ack ask for one:
+// occupancy changes, and every every_nth_batch-th batch. Each ack costs a
+// downlink (gateway airtime, network fair-use quota) and, when it is lost,
+// retransmissions, so confirmations are drawn from a token bucket refilled
+// at budget_per_day and holding at most one day of budget: the network's cap
+// is per day (TTN fair use: 10 downlinks), and a per-hour budget could not go
+// below 24 per day. Without a token,
+// or while the previous confirmed uplink is still in the stack, the uplink
+// goes out unconfirmed and counts as a fallback.
+#define CONFIRM_TOKEN_UNIT            1000U   // tokens are kept in 1/1000
+#define CONFIRM_BUDGET_WINDOW_S       86400U  // budget_per_day refills over this
+
+typedef enum {
+    CONFIRM_KIND_NONE = 0,      // never confirmed (stats, link report, summaries)
+    CONFIRM_KIND_STATE_CHANGE,  // an occupancy change is in the uplink
+    CONFIRM_KIND_BATCH          // batch without a change, see every_nth_batch
+} confirm_kind_t;
+
+typedef struct {
+    uint8_t budget_per_day;     // 0 = never confirm
+    uint8_t every_nth_batch;    // 0 = batches only for state changes
+    uint8_t pending;            // confirmed uplink in the stack
+    uint8_t batches_since;
+    uint32_t tokens;
+    uint32_t refill_ms;
+    uint32_t sent_ms;
+    uint32_t requested;
+    uint32_t acked;
+    uint32_t nacked;
+    uint32_t fallback;
+    uint32_t retries;
+    uint32_t rtt_avg_ms;
+    uint32_t rtt_max_ms;
+    uint32_t rtt_last_ms;
+} confirm_policy_t;
+
+// Starts with a full bucket, so the first changes after boot are confirmed.
+static inline void confirm_policy_reset(confirm_policy_t *p, uint8_t budget_per_day, uint8_t every_nth_batch,
+                                        uint32_t now_ms)
+{
+    p->budget_per_day = budget_per_day;
+    p->every_nth_batch = every_nth_batch;
+    p->pending = 0U;
+    p->batches_since = 0U;
+    p->tokens = (uint32_t)budget_per_day * CONFIRM_TOKEN_UNIT;
+    p->refill_ms = now_ms;
+    p->sent_ms = 0U;
+    p->requested = 0U;
+    p->acked = 0U;
+    p->nacked = 0U;
+    p->fallback = 0U;
+    p->retries = 0U;
+    p->rtt_avg_ms = 0U;
+    p->rtt_max_ms = 0U;
+    p->rtt_last_ms = 0U;
+}
+
+static inline void confirm_policy_refill(confirm_policy_t *p, uint32_t now_ms)
+{
+    uint32_t cap = (uint32_t)p->budget_per_day * CONFIRM_TOKEN_UNIT;
+    uint32_t elapsed = now_ms - p->refill_ms;
+    // budget_per_day tokens per 86 400 000 ms = budget_per_day / 86400 milli-tokens per ms.
+    uint64_t add = ((uint64_t)elapsed * p->budget_per_day) / CONFIRM_BUDGET_WINDOW_S;
+    if (add == 0U) {
+        return;
+    }
+    // Advance by the time actually converted, so the remainder is not lost.
+    p->refill_ms += (uint32_t)((add * CONFIRM_BUDGET_WINDOW_S) / p->budget_per_day);
+    uint64_t tokens = (uint64_t)p->tokens + add;
+    p->tokens = (tokens > cap) ? cap : (uint32_t)tokens;
+}
+
+// Downlink reconfiguration: counters are kept, the bucket is cut to the new
+// capacity.
+static inline void confirm_policy_configure(confirm_policy_t *p, uint8_t budget_per_day, uint8_t every_nth_batch,
+                                            uint32_t now_ms)
+{
+    if (p->budget_per_day != 0U) {
+        confirm_policy_refill(p, now_ms);
+    } else {
+        p->refill_ms = now_ms;
+    }
+    p->budget_per_day = budget_per_day;
+    p->every_nth_batch = every_nth_batch;
+    uint32_t cap = (uint32_t)budget_per_day * CONFIRM_TOKEN_UNIT;
+    if (p->tokens > cap) {
+        p->tokens = cap;
+    }
+}
+
+// Decides whether the next uplink of this kind asks for an ack. Does not
+// spend the token; call confirm_policy_on_send() once the stack accepted it.
+static inline bool confirm_policy_want(confirm_policy_t *p, confirm_kind_t kind, uint32_t now_ms)
+{
+    if (kind == CONFIRM_KIND_NONE || p->budget_per_day == 0U) {
+        return false;
+    }
+    if (kind == CONFIRM_KIND_BATCH
+            && (p->every_nth_batch == 0U || (uint8_t)(p->batches_since + 1U) < p->every_nth_batch)) {
+        return false;
+    }
+    confirm_policy_refill(p, now_ms);
+    if (p->pending || p->tokens < CONFIRM_TOKEN_UNIT) {
+        p->fallback++;
+        return false;
+    }
+    return true;
+}
+
+// Call for every uplink of `kind` the stack accepted.
+static inline void confirm_policy_on_send(confirm_policy_t *p, confirm_kind_t kind, bool confirmed, uint32_t now_ms)
+{
+    if (confirmed) {
+        p->batches_since = 0U;
+    } else if (kind == CONFIRM_KIND_BATCH && p->batches_since < 0xFFU) {
+        p->batches_since++;
+    }
+    if (!confirmed) {
+        return;
+    }
+    p->tokens -= CONFIRM_TOKEN_UNIT;
+    p->pending = 1U;
+    p->sent_ms = now_ms;
+    p->requested++;
+}
+
+// Call when the stack reports the end of the uplink: TX_DONE (acked) or a
+// TX error (no ack after the retries). nb_retries comes from the stack's TX
+// metadata. Returns false when no confirmed uplink was pending.
+static inline bool confirm_policy_on_tx_done(confirm_policy_t *p, bool acked, uint8_t nb_retries, uint32_t now_ms)
+{
+    if (!p->pending) {
+        return false;
+    }
+    p->pending = 0U;
+    p->retries += nb_retries;
+    if (!acked) {
+        p->nacked++;
+        return true;
+    }
+    uint32_t rtt = now_ms - p->sent_ms;
+    p->acked++;
+    p->rtt_last_ms = rtt;
+    if (rtt > p->rtt_max_ms) {
+        p->rtt_max_ms = rtt;
+    }
+    // EWMA, 1/8 weight.
+    p->rtt_avg_ms = (p->acked == 1U) ? rtt : p->rtt_avg_ms - (p->rtt_avg_ms >> 3) + (rtt >> 3);
+    return true;
+}
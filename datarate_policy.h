@@ -0,0 +1,165 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Application data-rate policy for EU868 (DR0 = SF12 .. DR5 = SF7), used with
+// network ADR off. At most one uplink per DR_POLICY_PROBE_INTERVAL_S carries
+// a LinkCheckReq: each answer is a downlink, and the network caps those
+// (TTN fair use: 10 per day). The answer gives the demodulation margin of the
+// best gateway at the probe's DR. Each DR step costs ~2.5 dB of margin, so the
+// policy jumps straight to the fastest DR that keeps DR_POLICY_TARGET_MARGIN_DB
+// in reserve, and steps down when the margin gets thin or transmissions keep
+// failing. An unanswered probe says nothing about the uplink (the network may
+// be out of downlink quota or duty cycle), so it only doubles the interval to
+// the next probe, up to DR_POLICY_PROBE_BACKOFF_MAX doublings.
+#define DR_POLICY_PROBE_INTERVAL_S    (6UL * 3600UL)  // 4 LinkCheckAns per day at most
+#define DR_POLICY_PROBE_BACKOFF_MAX   2U              // up to one probe per 24 h
+#define DR_POLICY_TARGET_MARGIN_DB    10
+#define DR_POLICY_LOW_MARGIN_DB       5
+#define DR_POLICY_SINGLE_GW_DB        3   // extra reserve without gateway diversity
+#define DR_POLICY_TX_FAIL_MAX         3U
+
+typedef enum {
+    DR_POLICY_HOLD = 0,
+    DR_POLICY_MARGIN_HIGH,
+    DR_POLICY_MARGIN_LOW,
+    DR_POLICY_TX_FAIL,
+    DR_POLICY_BOUNDS
+} dr_policy_reason_t;
+
+typedef struct {
+    uint8_t dr;
+    uint8_t probe_dr;
+    uint8_t probe_pending;
+    uint8_t probe_answered;
+    uint8_t lost_probes;
+    uint8_t tx_fail_streak;
+    uint8_t last_margin_db;
+    uint8_t last_gw_count;
+    uint32_t probe_sent_s;
+    uint32_t probe_due_s;
+    uint32_t lost_total;
+    uint32_t changes;
+} dr_policy_t;
+
+static inline const char *dr_policy_reason_name(dr_policy_reason_t reason)
+{
+    switch (reason) {
+        case DR_POLICY_MARGIN_HIGH: return "margin_high";
+        case DR_POLICY_MARGIN_LOW:  return "margin_low";
+        case DR_POLICY_TX_FAIL:     return "tx_fail";
+        case DR_POLICY_BOUNDS:      return "bounds";
+        default:                    return "hold";
+    }
+}
+
+// Starts at dr and probes on the first uplink.
+static inline void dr_policy_reset(dr_policy_t *p, uint8_t dr, uint32_t now_s)
+{
+    p->dr = dr;
+    p->probe_dr = dr;
+    p->probe_pending = 0U;
+    p->probe_answered = 0U;
+    p->lost_probes = 0U;
+    p->tx_fail_streak = 0U;
+    p->last_margin_db = 0U;
+    p->last_gw_count = 0U;
+    p->probe_sent_s = now_s;
+    p->probe_due_s = now_s;
+    p->lost_total = 0U;
+    p->changes = 0U;
+}
+
+static inline dr_policy_reason_t dr_policy_move(dr_policy_t *p, int target, uint8_t dr_min, uint8_t dr_max,
+                                                dr_policy_reason_t reason)
+{
+    if (target < (int)dr_min) {
+        target = dr_min;
+    } else if (target > (int)dr_max) {
+        target = dr_max;
+    }
+    if ((uint8_t)target == p->dr) {
+        return DR_POLICY_HOLD;
+    }
+    p->dr = (uint8_t)target;
+    p->changes++;
+    return reason;
+}
+
+// Re-applies the bounds after a configuration change.
+static inline dr_policy_reason_t dr_policy_clamp(dr_policy_t *p, uint8_t dr_min, uint8_t dr_max)
+{
+    return dr_policy_move(p, p->dr, dr_min, dr_max, DR_POLICY_BOUNDS);
+}
+
+static inline bool dr_policy_want_probe(const dr_policy_t *p, uint32_t now_s)
+{
+    return !p->probe_pending && (int32_t)(now_s - p->probe_due_s) >= 0;
+}
+
+// Call for every uplink handed to the stack; probe = it carries a LinkCheckReq.
+static inline void dr_policy_on_send(dr_policy_t *p, bool probe, uint32_t now_s)
+{
+    if (!probe) {
+        return;
+    }
+    p->probe_pending = 1U;
+    p->probe_answered = 0U;
+    p->probe_dr = p->dr;
+    p->probe_sent_s = now_s;
+    p->probe_due_s = now_s + (DR_POLICY_PROBE_INTERVAL_S << p->lost_probes);
+}
+
+static inline dr_policy_reason_t dr_policy_on_link_check(dr_policy_t *p, uint8_t margin_db, uint8_t gw_count,
+                                                         uint8_t dr_min, uint8_t dr_max)
+{
+    p->probe_answered = 1U;
+    p->lost_probes = 0U;
+    p->last_margin_db = margin_db;
+    p->last_gw_count = gw_count;
+
+    int margin = (int)margin_db;
+    if (gw_count < 2U) {
+        margin -= DR_POLICY_SINGLE_GW_DB;
+    }
+    if (margin < DR_POLICY_LOW_MARGIN_DB) {
+        int steps = (2 * (DR_POLICY_LOW_MARGIN_DB - margin) + 4) / 5;
+        return dr_policy_move(p, (int)p->probe_dr - steps, dr_min, dr_max, DR_POLICY_MARGIN_LOW);
+    }
+    int steps = (2 * (margin - DR_POLICY_TARGET_MARGIN_DB)) / 5;
+    if (steps > 0) {
+        return dr_policy_move(p, (int)p->probe_dr + steps, dr_min, dr_max, DR_POLICY_MARGIN_HIGH);
+    }
+    return DR_POLICY_HOLD;
+}
+
+// Call when the stack reports the end of an uplink (TX_DONE or a TX error).
+// A probe sent but still unanswered at that point is lost and backs the next
+// one off; one that failed to go out is retried on the next uplink.
+static inline dr_policy_reason_t dr_policy_on_tx_done(dr_policy_t *p, bool ok, uint8_t dr_min, uint8_t dr_max)
+{
+    if (p->probe_pending) {
+        p->probe_pending = 0U;
+        if (!p->probe_answered) {
+            if (!ok) {
+                p->probe_due_s = p->probe_sent_s;
+            } else {
+                p->lost_total++;
+                if (p->lost_probes < DR_POLICY_PROBE_BACKOFF_MAX) {
+                    p->lost_probes++;
+                }
+                p->probe_due_s = p->probe_sent_s + (DR_POLICY_PROBE_INTERVAL_S << p->lost_probes);
+            }
+        }
+    }
+
+    if (ok) {
+        p->tx_fail_streak = 0U;
+    } else if (++p->tx_fail_streak >= DR_POLICY_TX_FAIL_MAX) {
+        p->tx_fail_streak = 0U;
+        return dr_policy_move(p, (int)p->dr - 1, dr_min, dr_max, DR_POLICY_TX_FAIL);
+    }
+    return DR_POLICY_HOLD;
+}
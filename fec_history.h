@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol_lorawan_v1.h"
+#include "protocol_uart_v1.h"
+
+// Last FEC_V1_MAX_COPIES raw events handed to the uplink path, repeated as
+// compact copies in the following FPort 21 uplinks (build_fec_uplink_v1()).
+// An event lost with its own uplink, or never sent because the stack was
+// busy, is still delivered if any of the next `copies` uplinks gets through.
+typedef struct {
+    fec_copy_v1_t events[FEC_V1_MAX_COPIES];
+    uint32_t rx_ms[FEC_V1_MAX_COPIES];
+    uint8_t head;    // next slot to write
+    uint8_t count;
+} fec_history_t;
+
+static inline void fec_history_reset(fec_history_t *h)
+{
+    h->head = 0U;
+    h->count = 0U;
+}
+
+static inline void fec_history_push(fec_history_t *h, const vision_uart_payload_v1_t *ev, uint32_t now_ms)
+{
+    fec_copy_v1_t *c = &h->events[h->head];
+    c->node_id = ev->node_id;
+    c->msg_type = ev->msg_type;
+    c->flags = ev->flags;
+    c->luma = ev->luma;
+    c->occupied = ev->occupied;
+    c->counter_lo = (uint16_t)ev->counter;
+    h->rx_ms[h->head] = now_ms;
+    h->head = (uint8_t)((h->head + 1U) % FEC_V1_MAX_COPIES);
+    if (h->count < FEC_V1_MAX_COPIES) {
+        h->count++;
+    }
+}
+
+// Writes up to `copies` events, newest first, with their age at now_ms.
+static inline size_t fec_history_copies(const fec_history_t *h, size_t copies, uint32_t now_ms, fec_copy_v1_t *out)
+{
+    size_t n = (copies < h->count) ? copies : h->count;
+    size_t slot = h->head;
+    for (size_t i = 0; i < n; ++i) {
+        slot = (slot + FEC_V1_MAX_COPIES - 1U) % FEC_V1_MAX_COPIES;
+        out[i] = h->events[slot];
+        uint32_t age_s = (now_ms - h->rx_ms[slot]) / 1000U;
+        out[i].age_s = (age_s > 0xFFFFU) ? 0xFFFFU : (uint16_t)age_s;
+    }
+    return n;
+}
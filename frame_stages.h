@@ -0,0 +1,245 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gps_clock.h"
+#include "node_slot.h"
+#include "occupancy_window.h"
+#include "pipeline.h"
+#include "protocol_lorawan_v1.h"
+#include "protocol_uart_v1.h"
+
+// Stages of the frame data path (pipeline.h), shared by the firmware and the
+// host bench. A stage touches only the frame context and an Env it is handed
+// before the first frame (frame_pipeline_bind()); Env is the owner of
+// everything outside the frame:
+//
+//     const bridge_config_v1_t *config;
+//     runtime_stats_t *stats;
+//     const gps_clock_t *clock;
+//     node_slot_t *find_node(uint8_t node_id);   // nullptr = no slot, drop
+//     void on_drop(const frame_ctx_t &ctx, const char *reason);
+//     void on_accept(const frame_ctx_t &ctx);
+//     void send_batch(const frame_ctx_t &ctx);
+//     void send_raw(const frame_ctx_t &ctx);
+//
+// on_drop() is called for the first drop of each reason only.
+
+typedef struct {
+    uint32_t rx_ok;
+    uint32_t drop_crc;
+    uint32_t drop_len;
+    uint32_t drop_replay;
+    uint32_t drop_ver;
+    uint32_t tx_ok;
+    uint32_t tx_fail;
+    uint32_t suppressed;
+} runtime_stats_t;
+
+// Drops counted against the ESP port a frame came from.
+typedef struct {
+    uint32_t drop_ver;
+    uint32_t drop_replay;
+} frame_port_drops_t;
+
+typedef struct {
+    unsigned port;
+    frame_port_drops_t *drops;
+    const uint8_t *payload_bytes;
+    uint32_t now_ms;
+    uint32_t now_s;
+    vision_uart_payload_v1_t frame;
+    node_slot_t *node;
+    uint32_t event_s;
+} frame_ctx_t;
+
+// Heartbeats inside suppress_min_interval_s of the last forwarded one are
+// dropped unless luma moved by at least suppress_luma_delta.
+static inline bool frame_heartbeat_suppressed(node_slot_t *node, const vision_uart_payload_v1_t *frame,
+                                              const bridge_config_v1_t *cfg, uint32_t now_s)
+{
+    if (frame->msg_type != UART_V1_MSG_HEARTBEAT || cfg->suppress_min_interval_s == 0U) {
+        return false;
+    }
+    if (node->hb_valid) {
+        uint32_t age = now_s - node->hb_last_tx_s;
+        int luma_delta = (int)frame->luma - (int)node->hb_last_luma;
+        if (luma_delta < 0) {
+            luma_delta = -luma_delta;
+        }
+        bool luma_moved = cfg->suppress_luma_delta != 0U && luma_delta >= (int)cfg->suppress_luma_delta;
+        if (age < cfg->suppress_min_interval_s && !luma_moved) {
+            return true;
+        }
+    }
+    node->hb_valid = 1U;
+    node->hb_last_tx_s = now_s;
+    node->hb_last_luma = frame->luma;
+    return false;
+}
+
+template <typename Env>
+struct version_filter {
+    Env *env = nullptr;
+    bool logged = false;
+
+    static const char *name() { return "version"; }
+
+    stage_verdict_t process(frame_ctx_t &ctx)
+    {
+        if (ctx.frame.ver == UART_V1_VERSION) {
+            return STAGE_PASS;
+        }
+        env->stats->drop_ver++;
+        ctx.drops->drop_ver++;
+        if (!logged) {
+            logged = true;
+            env->on_drop(ctx, "ver");
+        }
+        return STAGE_DROP;
+    }
+};
+
+// Finds or creates the node slot and drops counters already seen.
+template <typename Env>
+struct replay_filter {
+    Env *env = nullptr;
+    bool logged = false;
+
+    static const char *name() { return "replay"; }
+
+    stage_verdict_t process(frame_ctx_t &ctx)
+    {
+        ctx.node = env->find_node(ctx.frame.node_id);
+        if (ctx.node != nullptr
+                && node_link_on_frame(&ctx.node->link, ctx.frame.counter, ctx.now_ms) == LINK_FRAME_NEW) {
+            return STAGE_PASS;
+        }
+        env->stats->drop_replay++;
+        ctx.drops->drop_replay++;
+        if (!logged) {
+            logged = true;
+            env->on_drop(ctx, "replay");
+        }
+        return STAGE_DROP;
+    }
+};
+
+template <typename Env>
+struct accept_stage {
+    Env *env = nullptr;
+
+    static const char *name() { return "accept"; }
+
+    stage_verdict_t process(frame_ctx_t &ctx)
+    {
+        ctx.node->rx_ok++;
+        env->stats->rx_ok++;
+        env->on_accept(ctx);
+        return STAGE_PASS;
+    }
+};
+
+// GPS time of the event once the bridge clock is synced, 0 before.
+template <typename Env>
+struct event_time_stage {
+    Env *env = nullptr;
+
+    static const char *name() { return "event_time"; }
+
+    stage_verdict_t process(frame_ctx_t &ctx)
+    {
+        ctx.event_s = 0U;
+        if (env->clock->synced) {
+            uint32_t gps_s = (uint32_t)(gps_clock_now_ms(env->clock, ctx.now_ms) / 1000U);
+            ctx.event_s = node_uptime_to_gps_s(&ctx.node->uptime_map, ctx.frame.uptime_s, gps_s);
+        }
+        return STAGE_PASS;
+    }
+};
+
+// Feeds the node's summary window; in summary-only mode that is the end.
+// Raw mode keeps no windows.
+template <typename Env>
+struct window_stage {
+    Env *env = nullptr;
+
+    static const char *name() { return "window"; }
+
+    stage_verdict_t process(frame_ctx_t &ctx)
+    {
+        if (env->config->forward_mode == FWD_V1_MODE_RAW) {
+            return STAGE_PASS;
+        }
+        occupancy_window_on_frame(&ctx.node->window,
+                                  ctx.frame.occupied != 0U,
+                                  (ctx.frame.flags & UART_V1_FLAG_LOW_LIGHT) != 0U,
+                                  ctx.frame.luma,
+                                  ctx.now_ms);
+        return (env->config->forward_mode == FWD_V1_MODE_SUMMARY) ? STAGE_DONE : STAGE_PASS;
+    }
+};
+
+template <typename Env>
+struct heartbeat_filter {
+    Env *env = nullptr;
+
+    static const char *name() { return "heartbeat"; }
+
+    stage_verdict_t process(frame_ctx_t &ctx)
+    {
+        if (!frame_heartbeat_suppressed(ctx.node, &ctx.frame, env->config, ctx.now_s)) {
+            return STAGE_PASS;
+        }
+        env->stats->suppressed++;
+        return STAGE_DROP;
+    }
+};
+
+template <typename Env>
+struct batch_sink {
+    Env *env = nullptr;
+
+    static const char *name() { return "batch"; }
+
+    stage_verdict_t process(frame_ctx_t &ctx)
+    {
+        if (!env->config->time_batch_on || !env->clock->synced) {
+            return STAGE_PASS;
+        }
+        env->send_batch(ctx);
+        return STAGE_DONE;
+    }
+};
+
+template <typename Env>
+struct raw_sink {
+    Env *env = nullptr;
+
+    static const char *name() { return "raw"; }
+
+    stage_verdict_t process(frame_ctx_t &ctx)
+    {
+        env->send_raw(ctx);
+        return STAGE_DONE;
+    }
+};
+
+template <typename Env>
+using frame_stage_pipeline = pipeline<frame_ctx_t,
+                                      version_filter<Env>,
+                                      replay_filter<Env>,
+                                      accept_stage<Env>,
+                                      event_time_stage<Env>,
+                                      window_stage<Env>,
+                                      heartbeat_filter<Env>,
+                                      batch_sink<Env>,
+                                      raw_sink<Env>>;
+
+template <typename Env>
+void frame_pipeline_bind(frame_stage_pipeline<Env> &p, Env *env)
+{
+    p.for_each_stage([env](auto &stage) { stage.env = env; });
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bridge clock disciplined to GPS time from LoRaWAN DeviceTimeAns. Between
+// syncs, GPS time is extrapolated from the local millisecond clock corrected
+// by an estimated drift, which each sync refines from the prediction error.
+#define GPS_CLOCK_DRIFT_LIMIT_PPM 500
+#define GPS_CLOCK_MIN_SPAN_MS     60000U
+
+typedef struct {
+    uint64_t anchor_gps_ms;
+    uint32_t anchor_local_ms;
+    int32_t drift_ppm;
+    int32_t last_error_ms;
+    uint32_t syncs;
+    uint8_t synced;
+} gps_clock_t;
+
+static inline uint64_t gps_clock_now_ms(const gps_clock_t *c, uint32_t local_ms)
+{
+    uint32_t elapsed = local_ms - c->anchor_local_ms;
+    int64_t correction = ((int64_t)elapsed * c->drift_ppm) / 1000000;
+    return (uint64_t)((int64_t)c->anchor_gps_ms + (int64_t)elapsed + correction);
+}
+
+static inline void gps_clock_sync(gps_clock_t *c, uint64_t gps_ms, uint32_t local_ms)
+{
+    if (c->synced) {
+        uint32_t span = local_ms - c->anchor_local_ms;
+        int64_t error = (int64_t)(gps_ms - gps_clock_now_ms(c, local_ms));
+        c->last_error_ms = (int32_t)error;
+        if (span >= GPS_CLOCK_MIN_SPAN_MS) {
+            // Half of the observed frequency error per sync keeps the loop stable.
+            int64_t drift = c->drift_ppm + (error * 1000000) / (int64_t)span / 2;
+            if (drift > GPS_CLOCK_DRIFT_LIMIT_PPM) {
+                drift = GPS_CLOCK_DRIFT_LIMIT_PPM;
+            } else if (drift < -GPS_CLOCK_DRIFT_LIMIT_PPM) {
+                drift = -GPS_CLOCK_DRIFT_LIMIT_PPM;
+            }
+            c->drift_ppm = (int32_t)drift;
+        }
+    }
+    c->anchor_gps_ms = gps_ms;
+    c->anchor_local_ms = local_ms;
+    c->synced = 1U;
+    c->syncs++;
+}
+
+// Maps a node's uptime_s to GPS seconds. The node offset (GPS - uptime) is
+// the smallest seen, i.e. the frame with the shortest UART transit, and may
+// creep up by 1 s per frame (beyond 1 s of jitter) to follow a slow ESP
+// clock. It restarts when uptime goes backwards (ESP reboot) or jumps past
+// the tolerance.
+#define NODE_UPTIME_TOLERANCE_S   30U
+
+typedef struct {
+    uint32_t offset_s;
+    uint32_t last_uptime_s;
+    uint8_t valid;
+} node_uptime_map_t;
+
+static inline uint32_t node_uptime_to_gps_s(node_uptime_map_t *m, uint32_t uptime_s, uint32_t arrival_gps_s)
+{
+    uint32_t sample = arrival_gps_s - uptime_s;
+    bool restart = !m->valid
+        || uptime_s < m->last_uptime_s
+        || sample + NODE_UPTIME_TOLERANCE_S < m->offset_s
+        || sample > m->offset_s + NODE_UPTIME_TOLERANCE_S;
+
+    if (restart || sample < m->offset_s) {
+        m->offset_s = sample;
+    } else if (sample > m->offset_s + 1U) {
+        m->offset_s++;
+    }
+    m->valid = 1U;
+    m->last_uptime_s = uptime_s;
+    return uptime_s + m->offset_s;
+}
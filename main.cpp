@@ -1,46 +1,103 @@
 #include <cstdarg>
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
 
 #include "mbed.h"
 #include "events/EventQueue.h"
+#include "kvstore_global_api.h"
 #include "lorawan/LoRaWANInterface.h"
 #include "lorawan/system/lorawan_data_structures.h"
 #include "SX1276_LoRaRadio.h"
+#include "mbedtls/cmac.h"
 
+#include "confirm_policy.h"
+#include "datarate_policy.h"
+#include "fec_history.h"
+#include "frame_stages.h"
+#include "gps_clock.h"
+#include "node_analytics.h"
+#include "node_registry.h"
+#include "node_slot.h"
+#include "occupancy_window.h"
+#include "pipeline.h"
+#include "protocol_lorawan_v1.h"
 #include "protocol_uart_v1.h"
+#include "rx_ring.h"
+#include "stm32l0_uart_wakeup.h"
+#include "trace_point.h"
 #include "ttn_credentials.h"
+#include "uart_v1_parser.h"
 
 using namespace events;
 
 namespace {
 
-constexpr uint8_t LORAWAN_FPORT = 15U;
+constexpr uint8_t LORAWAN_FPORT = LORA_V1_FPORT_EVENT;
 constexpr int UART_BAUDRATE = 115200;
-constexpr auto UART_POLL_PERIOD = 100ms;
+constexpr size_t ESP_RX_RING_SIZE = 128U;
+constexpr size_t ESP_PORT_COUNT = MBED_CONF_APP_ESP_UART_PORTS;
+constexpr size_t ESP_PORT_QUANTUM = UART_V1_FRAME_LEN;
+constexpr size_t ESP_DRAIN_ROUNDS = 4U;
+constexpr size_t PC_RX_RING_SIZE = 32U;
+constexpr auto JOIN_TICK_PERIOD = 10s;
+constexpr const char *CONFIG_KV_KEY = "/kv/bridge_cfg";
+constexpr uint16_t CONFIG_RECORD_MAGIC = 0xBC01U;
+constexpr size_t NODE_REGISTRY_CAPACITY = MBED_CONF_APP_NODE_REGISTRY_CAPACITY;
+constexpr auto SUMMARY_RETRY_PERIOD = 30s;
+constexpr auto TIME_RESYNC_PERIOD = std::chrono::hours(6);
+constexpr size_t MEM_STATS_MAX_THREADS = 6U;
+constexpr uint8_t CONFIRM_MSG_RETRIES = 3U;
 
+// KVStore record: bridge_config_v1_t behind a magic and the length it was
+// written with. Fields are only ever appended to bridge_config_v1_t, so a
+// shorter record from older firmware loads its prefix and the new fields
+// keep their defaults.
 typedef struct {
-    uint32_t rx_ok;
+    uint16_t magic;
+    uint16_t len;
+    bridge_config_v1_t cfg;
+} config_record_t;
+
+static_assert(ESP_PORT_COUNT >= 1U && ESP_PORT_COUNT <= 3U, "esp_uart_ports must be 1..3");
+#if MBED_CONF_APP_ESP_UART_PORTS >= 2
+static_assert(MBED_CONF_APP_ESP_UART1_TX != NC && MBED_CONF_APP_ESP_UART1_RX != NC,
+              "esp_uart_ports >= 2 needs esp_uart1_tx/esp_uart1_rx");
+#endif
+#if MBED_CONF_APP_ESP_UART_PORTS >= 3
+static_assert(MBED_CONF_APP_ESP_UART2_TX != NC && MBED_CONF_APP_ESP_UART2_RX != NC,
+              "esp_uart_ports >= 3 needs esp_uart2_tx/esp_uart2_rx");
+#endif
+
+typedef struct {
+    UnbufferedSerial *serial;
+    PinName rx_pin;
+    rx_ring_t<ESP_RX_RING_SIZE> rx;
+    uart_v1_parser_t parser;
+    uint32_t rx_bytes;
+    uint32_t frames_ok;
     uint32_t drop_crc;
     uint32_t drop_len;
-    uint32_t drop_replay;
-    uint32_t drop_ver;
-    uint32_t tx_ok;
-    uint32_t tx_fail;
-} runtime_stats_t;
-
-enum parser_state_t {
-    PARSER_WAIT_SOF1 = 0,
-    PARSER_WAIT_SOF2,
-    PARSER_WAIT_LEN,
-    PARSER_READ_PAYLOAD,
-    PARSER_READ_CRC
-};
+    frame_port_drops_t drops;
+    uint32_t rate_bytes;
+    uint32_t rate_ms;
+    bool rx_seen;
+    bool drop_logged_len;
+    bool drop_logged_crc;
+} esp_port_t;
 
 UnbufferedSerial pc(USBTX, USBRX, UART_BAUDRATE);
 UnbufferedSerial esp(PA_9, PA_10, UART_BAUDRATE);
+#if MBED_CONF_APP_ESP_UART_PORTS >= 2
+UnbufferedSerial esp1(MBED_CONF_APP_ESP_UART1_TX, MBED_CONF_APP_ESP_UART1_RX, UART_BAUDRATE);
+#endif
+#if MBED_CONF_APP_ESP_UART_PORTS >= 3
+UnbufferedSerial esp2(MBED_CONF_APP_ESP_UART2_TX, MBED_CONF_APP_ESP_UART2_RX, UART_BAUDRATE);
+#endif
 DigitalOut led_rx(LED1);
+DigitalOut wake_probe(MBED_CONF_APP_WAKE_PROBE_PIN);
+LowPowerTimer power_timer;
 
 static EventQueue ev_queue;
 SX1276_LoRaRadio radio;
@@ -48,41 +105,73 @@ LoRaWANInterface lorawan(radio);
 lorawan_app_callbacks_t callbacks = {};
 
 runtime_stats_t stats = {};
-uint32_t last_counter_by_node[256] = {0};
+bridge_config_v1_t config = {};
+dr_policy_t dr_policy = {};
+confirm_policy_t confirm_policy = {};
+int stats_event_id = 0;
+size_t link_report_cursor = 0U;
+typedef node_registry<uint8_t, node_slot_t, NODE_REGISTRY_CAPACITY> node_table_t;
+node_table_t nodes;
+int window_event_id = 0;
+uint8_t window_seq = 0U;
+summary_record_v1_t summary_pending[node_table_t::max_nodes];
+size_t summary_count = 0U;
+size_t summary_sent = 0U;
+int summary_retry_id = 0;
+gps_clock_t bridge_clock = {};
+uint8_t batch_buf[BATCH_V1_MAX_LEN];
+size_t batch_len = 0U;
+size_t batch_events = 0U;
+bool batch_has_change = false;
+fec_history_t fec_history = {};
+uint32_t batch_base_s = 0U;
+int batch_flush_id = 0;
 bool lora_joined = false;
 bool join_in_progress = false;
-bool rx_seen_once = false;
-uint32_t dropped_before_join = 0U;
+char console_line[16] = {0};
+size_t console_len = 0U;
+int join_tick_id = 0;
 
-parser_state_t parser_state = PARSER_WAIT_SOF1;
-uint8_t parser_len = 0U;
-uint8_t payload[UART_V1_PAYLOAD_LEN] = {0};
-uint8_t payload_index = 0U;
-uint8_t crc_rx[2] = {0};
-uint8_t crc_index = 0U;
-
-bool drop_logged_len = false;
-bool drop_logged_crc = false;
-bool drop_logged_replay = false;
-bool drop_logged_ver = false;
+esp_port_t esp_ports[ESP_PORT_COUNT] = {};
+size_t esp_port_next = 0U;
+rx_ring_t<PC_RX_RING_SIZE> pc_rx = {};
+volatile bool esp_rx_pending = false;
+volatile bool pc_rx_pending = false;
+volatile uint32_t esp_rx_irq_us = 0U;
+uint32_t irq_dispatch_max_us = 0U;
+uint32_t irq_dispatch_avg_us = 0U;
+volatile uint32_t ev_post_fail = 0U;
+bool stop_mode_wakeup = false;
+uint32_t dropped_before_join = 0U;
 
 void pc_log(const char *fmt, ...)
 {
+    TRACE_BEGIN(TRACE_PC_LOG);
     char line[200];
     va_list args;
     va_start(args, fmt);
     int n = vsnprintf(line, sizeof(line), fmt, args);
     va_end(args);
-    if (n <= 0) {
-        return;
+    if (n > 0) {
+        size_t out_len = (static_cast<size_t>(n) < sizeof(line)) ? static_cast<size_t>(n) : (sizeof(line) - 1U);
+        pc.write(line, out_len);
     }
-    size_t out_len = (static_cast<size_t>(n) < sizeof(line)) ? static_cast<size_t>(n) : (sizeof(line) - 1U);
-    pc.write(line, out_len);
+    TRACE_END(TRACE_PC_LOG);
 }
 
-void blink()
+uint32_t now_s()
 {
-    led_rx = !led_rx;
+    return (uint32_t)std::chrono::duration_cast<std::chrono::seconds>(Kernel::Clock::now().time_since_epoch()).count();
+}
+
+uint32_t now_ms()
+{
+    return (uint32_t)Kernel::Clock::now().time_since_epoch().count();
+}
+
+uint32_t gps_now_s()
+{
+    return (uint32_t)(gps_clock_now_ms(&bridge_clock, now_ms()) / 1000U);
 }
 
 void print_hex(const char *label, const uint8_t *buf, size_t len)
@@ -94,15 +183,31 @@ void print_hex(const char *label, const uint8_t *buf, size_t len)
     pc_log("\r\n");
 }
 
-void parser_reset()
+unsigned esp_port_index(const esp_port_t &port)
 {
-    parser_state = PARSER_WAIT_SOF1;
-    parser_len = 0U;
-    payload_index = 0U;
-    crc_index = 0U;
+    return (unsigned)(&port - esp_ports);
 }
 
-bool lorawan_send(uint8_t fport, const uint8_t *buf, uint8_t len)
+void esp_ports_init()
+{
+    esp_ports[0].serial = &esp;
+    esp_ports[0].rx_pin = PA_10;
+#if MBED_CONF_APP_ESP_UART_PORTS >= 2
+    esp_ports[1].serial = &esp1;
+    esp_ports[1].rx_pin = MBED_CONF_APP_ESP_UART1_RX;
+#endif
+#if MBED_CONF_APP_ESP_UART_PORTS >= 3
+    esp_ports[2].serial = &esp2;
+    esp_ports[2].rx_pin = MBED_CONF_APP_ESP_UART2_RX;
+#endif
+    for (esp_port_t &port : esp_ports) {
+        uart_v1_parser_reset(&port.parser);
+        port.serial->set_blocking(false);
+    }
+}
+
+// kind selects whether the uplink may ask for an ack (confirm_policy.h).
+bool lorawan_send(uint8_t fport, const uint8_t *buf, uint8_t len, confirm_kind_t kind = CONFIRM_KIND_NONE)
 {
     if (!lora_joined) {
         dropped_before_join++;
@@ -112,11 +217,25 @@ bool lorawan_send(uint8_t fport, const uint8_t *buf, uint8_t len)
         return false;
     }
 
-    int16_t status = lorawan.send(fport, const_cast<uint8_t *>(buf), len, MSG_UNCONFIRMED_FLAG);
+    bool probe = config.dr_mode == DR_V1_MODE_LINK && dr_policy_want_probe(&dr_policy, now_s());
+    if (probe) {
+        lorawan.add_link_check_request();
+    }
+    bool confirmed = confirm_policy_want(&confirm_policy, kind, now_ms());
+    TRACE_BEGIN(TRACE_LORAWAN_SEND);
+    int16_t status = lorawan.send(fport, const_cast<uint8_t *>(buf), len,
+                                  confirmed ? MSG_CONFIRMED_FLAG : MSG_UNCONFIRMED_FLAG);
+    TRACE_END(TRACE_LORAWAN_SEND);
+    if (status >= 0) {
+        dr_policy_on_send(&dr_policy, probe, now_s());
+        confirm_policy_on_send(&confirm_policy, kind, confirmed, now_ms());
+    } else if (probe) {
+        lorawan.remove_link_check_request();
+    }
 
     switch (status) {
         case LORAWAN_STATUS_OK:
-            pc_log("Uplink queued\r\n");
+            pc_log("Uplink queued%s\r\n", confirmed ? " (confirmed)" : "");
             return true;
         case LORAWAN_STATUS_WOULD_BLOCK:
             pc_log("LoRa busy\r\n");
@@ -130,132 +249,946 @@ bool lorawan_send(uint8_t fport, const uint8_t *buf, uint8_t len)
     }
 }
 
-void on_payload_valid(const uint8_t *payload_bytes)
+void config_save()
+{
+    config_record_t rec;
+    rec.magic = CONFIG_RECORD_MAGIC;
+    rec.len = sizeof(rec.cfg);
+    rec.cfg = config;
+    int err = kv_set(CONFIG_KV_KEY, &rec, sizeof(rec), 0);
+    if (err != MBED_SUCCESS) {
+        pc_log("Config save failed: %d\r\n", err);
+    }
+}
+
+void config_load()
 {
-    vision_uart_payload_v1_t frame;
-    deserialize_payload_v1(&frame, payload_bytes);
+    bridge_config_v1_defaults(&config);
+
+    config_record_t rec;
+    size_t actual = 0U;
+    int err = kv_get(CONFIG_KV_KEY, &rec, sizeof(rec), &actual);
+    if (err != MBED_SUCCESS) {
+        pc_log("Config defaults (kv_get=%d)\r\n", err);
+        return;
+    }
+    if (actual < offsetof(config_record_t, cfg) || rec.magic != CONFIG_RECORD_MAGIC
+            || rec.len > actual - offsetof(config_record_t, cfg)) {
+        pc_log("Config defaults (len=%u)\r\n", (unsigned)actual);
+        return;
+    }
+    memcpy(&config, &rec.cfg, (rec.len < sizeof(config)) ? rec.len : sizeof(config));
+    pc_log("Config loaded (seq=%u len=%u)\r\n", (unsigned)config.cmd_seq, (unsigned)rec.len);
+}
+
+void forward_config_to_esp()
+{
+    vision_uart_config_v1_t esp_cfg = {};
+    esp_cfg.ver = UART_V1_VERSION;
+    esp_cfg.msg_type = UART_V1_MSG_CONFIG;
+    esp_cfg.node_id = UART_V1_NODE_BROADCAST;
+    esp_cfg.suppress_luma_delta = config.suppress_luma_delta;
+    esp_cfg.heartbeat_s = config.heartbeat_s;
+    esp_cfg.suppress_min_interval_s = config.suppress_min_interval_s;
+
+    uint8_t frame[UART_V1_FRAME_LEN];
+    size_t len = build_uart_config_frame_v1(&esp_cfg, frame);
+    for (esp_port_t &port : esp_ports) {
+        port.serial->write(frame, len);
+    }
+    pc_log("[ESP_CFG] hb=%u\r\n", (unsigned)config.heartbeat_s);
+}
+
+void apply_policy_datarate(uint8_t from, dr_policy_reason_t reason)
+{
+    if (reason == DR_POLICY_HOLD) {
+        return;
+    }
+    lorawan_status_t st = lorawan.set_datarate(dr_policy.dr);
+    pc_log("[DR] %u -> %u reason=%s margin=%u gw=%u ret=%d\r\n",
+           (unsigned)from,
+           (unsigned)dr_policy.dr,
+           dr_policy_reason_name(reason),
+           (unsigned)dr_policy.last_margin_db,
+           (unsigned)dr_policy.last_gw_count,
+           (int)st);
+}
 
-    if (frame.ver != UART_V1_VERSION) {
-        stats.drop_ver++;
-        if (!drop_logged_ver) {
-            drop_logged_ver = true;
-            pc_log("[UART_DROP] reason=ver\r\n");
+// With ADR on, the network picks the data rate and the bridge only raises it
+// back to dr_min; with ADR off the data rate is pinned to dr_max. The link
+// policy restarts at dr_min and probes the link on the next uplink, unless it
+// was already running (keep_policy): then its data rate is only pulled back
+// inside the new bounds.
+void apply_datarate_caps(bool keep_policy)
+{
+    if (!lora_joined) {
+        return;
+    }
+    if (config.dr_mode == DR_V1_MODE_ADR) {
+        lorawan.enable_adaptive_datarate();
+        return;
+    }
+    lorawan.disable_adaptive_datarate();
+    uint8_t dr = config.dr_max;
+    if (config.dr_mode == DR_V1_MODE_LINK) {
+        if (keep_policy) {
+            uint8_t from = dr_policy.dr;
+            apply_policy_datarate(from, dr_policy_clamp(&dr_policy, config.dr_min, config.dr_max));
+            return;
         }
+        dr_policy_reset(&dr_policy, config.dr_min, now_s());
+        dr = dr_policy.dr;
+    }
+    lorawan_status_t st = lorawan.set_datarate(dr);
+    pc_log("[DR] %s dr=%u ret=%d\r\n", (config.dr_mode == DR_V1_MODE_LINK) ? "policy" : "fixed", (unsigned)dr, (int)st);
+}
+
+// LinkCheckAns, delivered through the application event queue while the
+// stack processes the downlink and before that uplink's TX_DONE, so the
+// policy sees the answer before on_policy_tx_done() closes the probe.
+void on_link_check(uint8_t margin_db, uint8_t gw_count)
+{
+    if (config.dr_mode != DR_V1_MODE_LINK) {
+        return;
+    }
+    uint8_t from = dr_policy.dr;
+    dr_policy_reason_t reason = dr_policy_on_link_check(&dr_policy, margin_db, gw_count, config.dr_min, config.dr_max);
+    pc_log("[LINK_CHECK] dr=%u margin=%u gw=%u\r\n", (unsigned)dr_policy.probe_dr, (unsigned)margin_db, (unsigned)gw_count);
+    apply_policy_datarate(from, reason);
+}
+
+void on_policy_tx_done(bool ok)
+{
+    if (config.dr_mode != DR_V1_MODE_LINK || !lora_joined) {
+        return;
+    }
+    if (dr_policy.probe_pending) {
+        lorawan.remove_link_check_request();
+    }
+    uint8_t from = dr_policy.dr;
+    apply_policy_datarate(from, dr_policy_on_tx_done(&dr_policy, ok, config.dr_min, config.dr_max));
+}
+
+// TX_DONE of a confirmed uplink means it was acked; a TX error means the
+// retries ran out without one.
+void on_confirm_tx_done(bool acked)
+{
+    if (!confirm_policy.pending) {
         return;
     }
+    lorawan_tx_metadata meta;
+    uint8_t retries = (lorawan.get_tx_metadata(meta) == LORAWAN_STATUS_OK) ? meta.nb_retries : 0U;
+    confirm_policy_on_tx_done(&confirm_policy, acked, retries, now_ms());
+    if (acked) {
+        pc_log("[CONFIRM] ack rtt_ms=%lu retries=%u\r\n", (unsigned long)confirm_policy.rtt_last_ms, (unsigned)retries);
+    } else {
+        pc_log("[CONFIRM] no ack retries=%u\r\n", (unsigned)retries);
+    }
+}
 
-    uint32_t last_counter = last_counter_by_node[frame.node_id];
-    if (frame.counter <= last_counter) {
-        stats.drop_replay++;
-        if (!drop_logged_replay) {
-            drop_logged_replay = true;
-            pc_log("[UART_DROP] reason=replay\r\n");
+void clamp_adr_datarate()
+{
+    if (config.dr_mode != DR_V1_MODE_ADR) {
+        return;
+    }
+    lorawan_tx_metadata meta;
+    if (lorawan.get_tx_metadata(meta) != LORAWAN_STATUS_OK) {
+        return;
+    }
+    uint8_t dr = meta.data_rate;
+    if (dr < config.dr_min) {
+        dr = config.dr_min;
+    } else if (dr > config.dr_max) {
+        dr = config.dr_max;
+    } else {
+        return;
+    }
+    lorawan.disable_adaptive_datarate();
+    lorawan.set_datarate(dr);
+    lorawan.enable_adaptive_datarate();
+    pc_log("[DR] clamp %u -> %u\r\n", (unsigned)meta.data_rate, (unsigned)dr);
+}
+
+void link_report_tick()
+{
+    link_report_record_v1_t records[LINK_V1_MAX_RECORDS];
+    size_t n = 0U;
+    size_t index = 0U;
+    nodes.for_each([&](uint8_t id, node_slot_t &node) {
+        if (index++ < link_report_cursor || n >= LINK_V1_MAX_RECORDS) {
+            return;
         }
+        records[n].node_id = id;
+        records[n].lost = node.link.lost;
+        records[n].gaps = node.link.gaps;
+        records[n].duplicates = node.link.duplicates;
+        records[n].iat_avg_ms = node.link.iat_avg_ms;
+        n++;
+    });
+    link_report_cursor = (link_report_cursor + n >= nodes.size()) ? 0U : link_report_cursor + n;
+    if (n == 0U) {
+        return;
+    }
+
+    uint8_t buf[1 + LINK_V1_RECORD_LEN * LINK_V1_MAX_RECORDS];
+    size_t len = build_link_report_v1(records, n, buf);
+    lorawan_send(LORA_V1_FPORT_LINK, buf, (uint8_t)len);
+}
+
+void request_time_sync()
+{
+    if (!lora_joined) {
         return;
     }
-    last_counter_by_node[frame.node_id] = frame.counter;
+    lorawan_status_t st = lorawan.add_device_time_request();
+    pc_log("[TIME] DeviceTimeReq queued ret=%d\r\n", (int)st);
+}
 
-    stats.rx_ok++;
-    pc_log("[UART_OK] t=%lu ctr=%lu occ=%u l=%u\r\n",
-           (unsigned long)frame.uptime_s,
-           (unsigned long)frame.counter,
-           (unsigned)frame.occupied,
-           (unsigned)frame.luma);
+void on_time_synched()
+{
+    // The stack reports milliseconds since the GPS epoch.
+    uint64_t gps_ms = (uint64_t)lorawan.get_current_gps_time();
+    if (gps_ms == 0U) {
+        return;
+    }
+    gps_clock_sync(&bridge_clock, gps_ms, now_ms());
+    pc_log("[TIME] sync n=%lu gps_s=%lu err_ms=%ld drift_ppm=%ld\r\n",
+           (unsigned long)bridge_clock.syncs,
+           (unsigned long)(gps_ms / 1000U),
+           (long)bridge_clock.last_error_ms,
+           (long)bridge_clock.drift_ppm);
+}
 
-    bool sent = lorawan_send(LORAWAN_FPORT, payload_bytes, UART_V1_PAYLOAD_LEN);
+void batch_flush()
+{
+    if (batch_flush_id != 0) {
+        ev_queue.cancel(batch_flush_id);
+        batch_flush_id = 0;
+    }
+    if (batch_events == 0U) {
+        return;
+    }
+
+    confirm_kind_t kind = batch_has_change ? CONFIRM_KIND_STATE_CHANGE : CONFIRM_KIND_BATCH;
+    bool sent = lorawan_send(LORA_V1_FPORT_BATCH, batch_buf, (uint8_t)batch_len, kind);
+    if (sent) {
+        stats.tx_ok++;
+    } else {
+        stats.tx_fail++;
+    }
+    pc_log("[LORA_TX] port=%u len=%u events=%u ok=%u\r\n",
+           (unsigned)LORA_V1_FPORT_BATCH,
+           (unsigned)batch_len,
+           (unsigned)batch_events,
+           sent ? 1U : 0U);
+    batch_len = 0U;
+    batch_events = 0U;
+    batch_has_change = false;
+}
+
+void batch_flush_timeout()
+{
+    batch_flush_id = 0;
+    batch_flush();
+}
+
+// Events of one uplink share base_gps_s (time of the first one) and carry a
+// 16-bit offset from it. A batch leaves when full or batch_age_s after its
+// first event, and early when an event does not fit the offset: one older
+// than the base (a node with a larger clock offset, or the clock stepped
+// back on a sync) or more than 0xFFFF s after it.
+void batch_add(const vision_uart_payload_v1_t &frame, uint32_t event_s)
+{
+    if (batch_events != 0U && (event_s < batch_base_s || event_s - batch_base_s > 0xFFFFU)) {
+        batch_flush();
+    }
+    if (batch_events == 0U) {
+        batch_base_s = event_s;
+        batch_len = batch_v1_begin(batch_buf, batch_base_s);
+        batch_flush_id = ev_queue.call_in(std::chrono::seconds(config.batch_age_s), batch_flush_timeout);
+    }
+
+    batch_len = batch_v1_append(batch_buf, batch_len, &frame, (uint16_t)(event_s - batch_base_s));
+    batch_events++;
+    batch_has_change |= frame.msg_type == UART_V1_MSG_OCCUPANCY_CHANGED;
+    if (batch_events >= BATCH_V1_MAX_EVENTS) {
+        batch_flush();
+    }
+}
+
+void stats_tick()
+{
+    const uint32_t counters[STATS_V1_COUNTERS] = {
+        stats.rx_ok, stats.drop_crc, stats.drop_len, stats.drop_replay,
+        stats.drop_ver, stats.tx_ok, stats.tx_fail, stats.suppressed
+    };
+    uint8_t buf[STATS_V1_LEN];
+    size_t len = build_stats_uplink_v1(counters, buf);
+    lorawan_send(LORA_V1_FPORT_STATS, buf, (uint8_t)len);
+
+    // Half a period later, so the two uplinks do not contend for the stack.
+    if (config.link_report_on) {
+        ev_queue.call_in(std::chrono::seconds(config.stats_interval_s / 2U), link_report_tick);
+    }
+}
+
+void send_summary_chunk();
+
+void summary_retry()
+{
+    summary_retry_id = 0;
+    send_summary_chunk();
+}
+
+void send_summary_chunk()
+{
+    if (summary_sent >= summary_count) {
+        return;
+    }
+    size_t n = summary_count - summary_sent;
+    if (n > SUMMARY_V1_MAX_RECORDS) {
+        n = SUMMARY_V1_MAX_RECORDS;
+    }
+
+    uint8_t buf[SUMMARY_V1_HEADER_LEN + SUMMARY_V1_RECORD_LEN * SUMMARY_V1_MAX_RECORDS];
+    size_t len = build_summary_uplink_v1(window_seq, config.window_s, &summary_pending[summary_sent], n, buf);
+    if (lorawan_send(LORA_V1_FPORT_SUMMARY, buf, (uint8_t)len)) {
+        summary_sent += n;
+    } else if (lora_joined) {
+        if (summary_retry_id == 0) {
+            summary_retry_id = ev_queue.call_in(SUMMARY_RETRY_PERIOD, summary_retry);
+        }
+    } else {
+        summary_sent = summary_count;
+    }
+}
+
+// Closes every node window and queues one summary record per node; the
+// records go out FPort 19 chunk by chunk, the next one after each TX_DONE.
+void window_tick()
+{
+    if (summary_sent < summary_count) {
+        pc_log("[SUMMARY] window %u not fully sent (%u/%u)\r\n",
+               (unsigned)window_seq, (unsigned)summary_sent, (unsigned)summary_count);
+    }
+
+    uint32_t now = now_ms();
+    summary_count = 0U;
+    summary_sent = 0U;
+    window_seq++;
+    nodes.for_each([&](uint8_t id, node_slot_t &node) {
+        occupancy_summary_t sum;
+        if (!occupancy_window_close(&node.window, now, &sum)) {
+            return;
+        }
+        summary_record_v1_t &r = summary_pending[summary_count++];
+        r.node_id = id;
+        r.occupied_ms = sum.occupied_ms;
+        r.low_light_ms = sum.low_light_ms;
+        r.transitions = sum.transitions;
+        r.luma_min = sum.luma_min;
+        r.luma_max = sum.luma_max;
+        r.luma_mean = sum.luma_mean;
+        r.occupied = sum.occupied;
+    });
+
+    pc_log("[SUMMARY] window=%u nodes=%u\r\n", (unsigned)window_seq, (unsigned)summary_count);
+    send_summary_chunk();
+}
+
+// The window timer only runs while summaries are forwarded. Leaving raw mode
+// starts every node window afresh, entering it drops any unsent chunks.
+void schedule_window()
+{
+    bool running = window_event_id != 0;
+    if (running) {
+        ev_queue.cancel(window_event_id);
+        window_event_id = 0;
+    }
+    if (config.forward_mode == FWD_V1_MODE_RAW) {
+        summary_sent = summary_count;
+        return;
+    }
+    if (!running) {
+        nodes.for_each([](uint8_t, node_slot_t &node) {
+            node.window = {};
+        });
+    }
+    window_event_id = ev_queue.call_every(std::chrono::seconds(config.window_s), window_tick);
+}
+
+void print_node_table()
+{
+    pc_log("[NODES] n=%u cap=%u rejected=%lu\r\n",
+           (unsigned)nodes.size(),
+           (unsigned)nodes.max_nodes,
+           (unsigned long)nodes.rejected());
+    pc_log("   id       rx     lost   gaps    dup  stale  loss%%  iat_avg_ms  iat_max_ms\r\n");
+    nodes.for_each([](uint8_t id, node_slot_t &node) {
+        uint32_t loss_bp = node_link_loss_bp(&node.link, node.rx_ok);
+        pc_log("%5u %8lu %8lu %6lu %6lu %6lu %3lu.%02lu %11lu %11lu\r\n",
+               (unsigned)id,
+               (unsigned long)node.rx_ok,
+               (unsigned long)node.link.lost,
+               (unsigned long)node.link.gaps,
+               (unsigned long)node.link.duplicates,
+               (unsigned long)node.link.stale,
+               (unsigned long)(loss_bp / 100U),
+               (unsigned long)(loss_bp % 100U),
+               (unsigned long)node.link.iat_avg_ms,
+               (unsigned long)node.link.iat_max_ms);
+    });
+}
+
+void print_stats()
+{
+    pc_log("[STATS] rx_ok=%lu crc=%lu len=%lu replay=%lu ver=%lu tx_ok=%lu tx_fail=%lu sup=%lu\r\n",
+           (unsigned long)stats.rx_ok,
+           (unsigned long)stats.drop_crc,
+           (unsigned long)stats.drop_len,
+           (unsigned long)stats.drop_replay,
+           (unsigned long)stats.drop_ver,
+           (unsigned long)stats.tx_ok,
+           (unsigned long)stats.tx_fail,
+           (unsigned long)stats.suppressed);
+    pc_log("[DR] mode=%u dr=%u margin=%u gw=%u changes=%lu lost_probes=%lu next_probe_s=%ld\r\n",
+           (unsigned)config.dr_mode,
+           (unsigned)dr_policy.dr,
+           (unsigned)dr_policy.last_margin_db,
+           (unsigned)dr_policy.last_gw_count,
+           (unsigned long)dr_policy.changes,
+           (unsigned long)dr_policy.lost_total,
+           (long)(int32_t)(dr_policy.probe_due_s - now_s()));
+    pc_log("[CONFIRM] budget=%u/d tokens=%lu.%03lu req=%lu ack=%lu no_ack=%lu fallback=%lu retries=%lu rtt_avg_ms=%lu rtt_max_ms=%lu\r\n",
+           (unsigned)confirm_policy.budget_per_day,
+           (unsigned long)(confirm_policy.tokens / CONFIRM_TOKEN_UNIT),
+           (unsigned long)(confirm_policy.tokens % CONFIRM_TOKEN_UNIT),
+           (unsigned long)confirm_policy.requested,
+           (unsigned long)confirm_policy.acked,
+           (unsigned long)confirm_policy.nacked,
+           (unsigned long)confirm_policy.fallback,
+           (unsigned long)confirm_policy.retries,
+           (unsigned long)confirm_policy.rtt_avg_ms,
+           (unsigned long)confirm_policy.rtt_max_ms);
+}
+
+uint32_t power_now_us()
+{
+    return (uint32_t)power_timer.elapsed_time().count();
+}
+
+// Sleep and Stop shares need the CPU statistics, which only tracepoint
+// builds turn on (CMakeLists.txt).
+void print_power()
+{
+#if defined(MBED_CPU_STATS_ENABLED)
+    mbed_stats_cpu_t cpu;
+    mbed_stats_cpu_get(&cpu);
+    uint64_t up = (cpu.uptime != 0U) ? cpu.uptime : 1U;
+    uint32_t sleep_pm = (uint32_t)((cpu.sleep_time * 1000U) / up);
+    uint32_t deep_pm = (uint32_t)((cpu.deep_sleep_time * 1000U) / up);
+    pc_log("[POWER] stop_wakeup=%u up_s=%lu sleep=%lu.%lu%% deep=%lu.%lu%%\r\n",
+           stop_mode_wakeup ? 1U : 0U,
+           (unsigned long)(cpu.uptime / 1000000U),
+           (unsigned long)(sleep_pm / 10U), (unsigned long)(sleep_pm % 10U),
+           (unsigned long)(deep_pm / 10U), (unsigned long)(deep_pm % 10U));
+#else
+    pc_log("[POWER] stop_wakeup=%u up_s=%lu\r\n", stop_mode_wakeup ? 1U : 0U, (unsigned long)(now_ms() / 1000U));
+#endif
+    uint32_t esp_bytes = 0U;
+    uint32_t ring_ovf = 0U;
+    for (const esp_port_t &port : esp_ports) {
+        esp_bytes += port.rx_bytes;
+        ring_ovf += port.rx.overflow;
+    }
+    pc_log("[POWER] irq_to_dispatch_us avg=%lu max=%lu esp_bytes=%lu ring_ovf=%lu post_fail=%lu\r\n",
+           (unsigned long)irq_dispatch_avg_us,
+           (unsigned long)irq_dispatch_max_us,
+           (unsigned long)esp_bytes,
+           (unsigned long)ring_ovf,
+           (unsigned long)ev_post_fail);
+}
+
+// Throughput is averaged since the previous "ports" command.
+void print_ports()
+{
+    uint32_t now = now_ms();
+    pc_log("port   bytes     B/s   frames    crc    len    ver replay    ovf\r\n");
+    for (esp_port_t &port : esp_ports) {
+        uint32_t span_ms = now - port.rate_ms;
+        uint32_t rate = (span_ms != 0U) ? (uint32_t)(((uint64_t)(port.rx_bytes - port.rate_bytes) * 1000U) / span_ms) : 0U;
+        port.rate_bytes = port.rx_bytes;
+        port.rate_ms = now;
+        pc_log("%4u %7lu %7lu %8lu %6lu %6lu %6lu %6lu %6lu\r\n",
+               esp_port_index(port),
+               (unsigned long)port.rx_bytes,
+               (unsigned long)rate,
+               (unsigned long)port.frames_ok,
+               (unsigned long)port.drop_crc,
+               (unsigned long)port.drop_len,
+               (unsigned long)port.drops.drop_ver,
+               (unsigned long)port.drops.drop_replay,
+               (unsigned long)port.rx.overflow);
+    }
+}
+
+#if TRACE_POINTS_ENABLED
+// Durations since the previous "trace" command, which resets the table.
+void print_trace()
+{
+    pc_log("tracepoint               count      min      avg      max (%s)\r\n", TRACE_UNIT);
+    for (size_t i = 0; i < TRACE_ID_COUNT; ++i) {
+        const trace_stat_t s = trace_stats()[i];
+        pc_log("%-20s %9lu %8lu %8lu %8lu\r\n",
+               trace_name((trace_id_t)i),
+               (unsigned long)s.count,
+               (unsigned long)((s.count != 0U) ? s.min : 0U),
+               (unsigned long)trace_avg(&s),
+               (unsigned long)s.max);
+    }
+    trace_reset();
+}
+#endif
+
+// Stack high-water marks need platform.stack-stats-enabled; static RAM and
+// flash per module come from tools/size_report.py at build time.
+void print_mem()
+{
+#if defined(MBED_STACK_STATS_ENABLED)
+    static mbed_stats_stack_t threads[MEM_STATS_MAX_THREADS];
+    size_t n = mbed_stats_stack_get_each(threads, MEM_STATS_MAX_THREADS);
+    for (size_t i = 0; i < n; ++i) {
+        pc_log("[MEM] thread=0x%08lx stack_max=%lu stack_size=%lu\r\n",
+               (unsigned long)threads[i].thread_id,
+               (unsigned long)threads[i].max_size,
+               (unsigned long)threads[i].reserved_size);
+    }
+#endif
+#if defined(MBED_HEAP_STATS_ENABLED)
+    mbed_stats_heap_t heap;
+    mbed_stats_heap_get(&heap);
+    pc_log("[MEM] heap_max=%lu heap_size=%lu\r\n",
+           (unsigned long)heap.max_size,
+           (unsigned long)heap.reserved_size);
+#endif
+    pc_log("[MEM] esp_ports=%u B nodes=%u B\r\n", (unsigned)sizeof(esp_ports), (unsigned)sizeof(nodes));
+}
+
+void print_pipeline();
+
+void console_command(const char *line)
+{
+    if (strcmp(line, "nodes") == 0) {
+        print_node_table();
+    } else if (strcmp(line, "stats") == 0) {
+        print_stats();
+    } else if (strcmp(line, "power") == 0) {
+        print_power();
+    } else if (strcmp(line, "ports") == 0) {
+        print_ports();
+    } else if (strcmp(line, "mem") == 0) {
+        print_mem();
+    } else if (strcmp(line, "pipeline") == 0) {
+        print_pipeline();
+#if TRACE_POINTS_ENABLED
+    } else if (strcmp(line, "trace") == 0) {
+        print_trace();
+#endif
+    } else if (line[0] != '\0') {
+        pc_log("commands: nodes, stats, power, ports, mem, pipeline%s\r\n", TRACE_POINTS_ENABLED ? ", trace" : "");
+    }
+}
+
+void poll_pc_console()
+{
+    pc_rx_pending = false;
+    uint8_t byte = 0;
+    while (rx_ring_pop(&pc_rx, &byte)) {
+        if (byte == '\r' || byte == '\n') {
+            console_line[console_len] = '\0';
+            console_command(console_line);
+            console_len = 0U;
+        } else if (console_len < sizeof(console_line) - 1U) {
+            console_line[console_len++] = (char)byte;
+        }
+    }
+}
+
+void schedule_stats()
+{
+    if (stats_event_id != 0) {
+        ev_queue.cancel(stats_event_id);
+        stats_event_id = 0;
+    }
+    if (config.stats_interval_s != 0U) {
+        stats_event_id = ev_queue.call_every(std::chrono::seconds(config.stats_interval_s), stats_tick);
+    }
+}
+
+bool cmd_mic_valid(const uint8_t *buf, size_t len)
+{
+    const mbedtls_cipher_info_t *info = mbedtls_cipher_info_from_type(MBEDTLS_CIPHER_AES_128_ECB);
+    uint8_t mac[16];
+    if (info == nullptr
+            || mbedtls_cipher_cmac(info, TTN_CMD_KEY, 128, buf, len - DL_V1_MIC_LEN, mac) != 0) {
+        return false;
+    }
+    uint8_t diff = 0U;
+    for (size_t i = 0; i < DL_V1_MIC_LEN; ++i) {
+        diff |= (uint8_t)(mac[i] ^ buf[len - DL_V1_MIC_LEN + i]);
+    }
+    return diff == 0U;
+}
+
+void handle_downlink(const uint8_t *buf, size_t len)
+{
+    if (len < DL_V1_HEADER_LEN + DL_V1_MIC_LEN) {
+        pc_log("[CMD_DROP] reason=len\r\n");
+        return;
+    }
+    if (!cmd_mic_valid(buf, len)) {
+        pc_log("[CMD_DROP] reason=mic\r\n");
+        return;
+    }
+    uint16_t seq = lora_v1_read_be16(&buf[1]);
+    if (!dl_v1_seq_newer(seq, config.cmd_seq)) {
+        pc_log("[CMD_DROP] reason=seq seq=%u last=%u\r\n", (unsigned)seq, (unsigned)config.cmd_seq);
+        return;
+    }
+
+    bridge_config_v1_t next = config;
+    uint8_t prev_dr_mode = config.dr_mode;
+    uint16_t changed = 0U;
+    dl_v1_status_t st = dl_v1_apply(buf, len - DL_V1_MIC_LEN, &next, &changed);
+    if (st != DL_V1_OK) {
+        pc_log("[CMD_DROP] reason=parse status=%d\r\n", (int)st);
+        return;
+    }
+
+    config = next;
+    config_save();
+    pc_log("[CMD] seq=%u hb=%u sup=%u/%u stats=%u dr_mode=%u dr=%u..%u\r\n",
+           (unsigned)config.cmd_seq,
+           (unsigned)config.heartbeat_s,
+           (unsigned)config.suppress_luma_delta,
+           (unsigned)config.suppress_min_interval_s,
+           (unsigned)config.stats_interval_s,
+           (unsigned)config.dr_mode,
+           (unsigned)config.dr_min,
+           (unsigned)config.dr_max);
+
+    if ((changed & (DL_V1_CHANGED_HEARTBEAT | DL_V1_CHANGED_SUPPRESS)) != 0U) {
+        forward_config_to_esp();
+    }
+    if ((changed & DL_V1_CHANGED_STATS) != 0U) {
+        schedule_stats();
+    }
+    if ((changed & DL_V1_CHANGED_DR) != 0U) {
+        apply_datarate_caps(prev_dr_mode == DR_V1_MODE_LINK);
+    }
+    if ((changed & DL_V1_CHANGED_FORWARD) != 0U) {
+        schedule_window();
+    }
+    if ((changed & DL_V1_CHANGED_TIME_BATCH) != 0U && !config.time_batch_on) {
+        batch_flush();
+    }
+    if ((changed & DL_V1_CHANGED_CONFIRM) != 0U) {
+        confirm_policy_configure(&confirm_policy, config.confirm_budget_d, config.confirm_every_batch, now_ms());
+        pc_log("[CONFIRM] budget=%u/d every_batch=%u\r\n",
+               (unsigned)config.confirm_budget_d, (unsigned)config.confirm_every_batch);
+    }
+    if ((changed & DL_V1_CHANGED_FEC) != 0U) {
+        fec_history_reset(&fec_history);
+        pc_log("[FEC] copies=%u\r\n", (unsigned)config.fec_copies);
+    }
+}
+
+void lora_receive()
+{
+    uint8_t buf[DL_V1_MAX_LEN];
+    uint8_t port = 0U;
+    int flags = 0;
+    int16_t n = lorawan.receive(buf, sizeof(buf), port, flags);
+    if (n < 0) {
+        pc_log("LoRa receive error: %d\r\n", (int)n);
+        return;
+    }
+    pc_log("[LORA_RX] port=%u len=%d\r\n", (unsigned)port, (int)n);
+    if (port == LORA_V1_FPORT_CMD) {
+        handle_downlink(buf, (size_t)n);
+    }
+}
+
+// FPort 15, or FPort 21 with copies of the previous events when FEC is on.
+void send_raw_event(const vision_uart_payload_v1_t &frame, const uint8_t *payload_bytes)
+{
+    uint8_t fport = LORAWAN_FPORT;
+    const uint8_t *buf = payload_bytes;
+    size_t len = UART_V1_PAYLOAD_LEN;
+    uint8_t fec_buf[FEC_V1_MAX_LEN];
+    if (config.fec_copies != 0U) {
+        fec_copy_v1_t copies[FEC_V1_MAX_COPIES];
+        size_t n = fec_history_copies(&fec_history, config.fec_copies, now_ms(), copies);
+        len = build_fec_uplink_v1(payload_bytes, copies, n, fec_buf);
+        fport = LORA_V1_FPORT_FEC;
+        buf = fec_buf;
+        fec_history_push(&fec_history, &frame, now_ms());
+    }
+
+    confirm_kind_t kind = (frame.msg_type == UART_V1_MSG_OCCUPANCY_CHANGED) ? CONFIRM_KIND_STATE_CHANGE : CONFIRM_KIND_NONE;
+    bool sent = lorawan_send(fport, buf, (uint8_t)len, kind);
     if (sent) {
         stats.tx_ok++;
     } else {
         stats.tx_fail++;
     }
     pc_log("[LORA_TX] port=%u len=%u ok=%u\r\n",
-           (unsigned)LORAWAN_FPORT,
-           (unsigned)UART_V1_PAYLOAD_LEN,
+           (unsigned)fport,
+           (unsigned)len,
            sent ? 1U : 0U);
 }
 
-void handle_uart_byte(uint8_t byte)
+// Frame data path, one stage per step (frame_stages.h). A frame from any ESP
+// port enters frame_pipeline through on_payload_valid() and leaves at the
+// first stage that drops it or sends it on. bridge_env is what the stages
+// see of the firmware.
+struct bridge_env_t {
+    const bridge_config_v1_t *config;
+    runtime_stats_t *stats;
+    const gps_clock_t *clock;
+
+    node_slot_t *find_node(uint8_t node_id)
+    {
+        bool inserted = false;
+        node_slot_t *node = nodes.find_or_insert(node_id, &inserted);
+        if (node == nullptr && nodes.rejected() == 1U) {
+            pc_log("[NODE] table full (%u nodes), id=%u rejected\r\n", (unsigned)nodes.max_nodes, (unsigned)node_id);
+        }
+        return node;
+    }
+
+    void on_drop(const frame_ctx_t &ctx, const char *reason)
+    {
+        pc_log("[UART_DROP] port=%u reason=%s\r\n", ctx.port, reason);
+    }
+
+    void on_accept(const frame_ctx_t &ctx)
+    {
+        led_rx = !led_rx;
+        pc_log("[UART_OK] port=%u t=%lu ctr=%lu occ=%u l=%u\r\n",
+               ctx.port,
+               (unsigned long)ctx.frame.uptime_s,
+               (unsigned long)ctx.frame.counter,
+               (unsigned)ctx.frame.occupied,
+               (unsigned)ctx.frame.luma);
+    }
+
+    void send_batch(const frame_ctx_t &ctx)
+    {
+        batch_add(ctx.frame, ctx.event_s);
+    }
+
+    void send_raw(const frame_ctx_t &ctx)
+    {
+        send_raw_event(ctx.frame, ctx.payload_bytes);
+    }
+};
+
+typedef frame_stage_pipeline<bridge_env_t> frame_pipeline_t;
+
+bridge_env_t bridge_env = {&config, &stats, &bridge_clock};
+frame_pipeline_t frame_pipeline;
+
+// Frames in, dropped and sent on per stage; the rest passed to the next one.
+void print_pipeline()
+{
+    pc_log("stage           in   drop   done\r\n");
+    frame_pipeline.for_each([](const char *name, const stage_stats_t &s) {
+        pc_log("%-10s %7lu %6lu %6lu\r\n",
+               name,
+               (unsigned long)s.in,
+               (unsigned long)s.dropped,
+               (unsigned long)s.done);
+    });
+}
+
+void on_payload_valid(esp_port_t &port, const uint8_t *payload_bytes)
 {
-    if (!rx_seen_once) {
-        rx_seen_once = true;
-        pc_log("[UART_RX] first_byte=0x%02X\r\n", (unsigned)byte);
+    frame_ctx_t ctx = {};
+    ctx.port = esp_port_index(port);
+    ctx.drops = &port.drops;
+    ctx.payload_bytes = payload_bytes;
+    ctx.now_ms = now_ms();
+    ctx.now_s = now_s();
+    deserialize_payload_v1(&ctx.frame, payload_bytes);
+    frame_pipeline.run(ctx);
+}
+
+void handle_uart_byte(esp_port_t &port, uint8_t byte)
+{
+    TRACE_BEGIN(TRACE_UART_BYTE);
+    if (!port.rx_seen) {
+        port.rx_seen = true;
+        pc_log("[UART_RX] port=%u first_byte=0x%02X\r\n", esp_port_index(port), (unsigned)byte);
     }
 
-    switch (parser_state) {
-        case PARSER_WAIT_SOF1:
-            if (byte == UART_V1_SOF1) {
-                parser_state = PARSER_WAIT_SOF2;
-            }
+    switch (uart_v1_parser_feed(&port.parser, byte)) {
+        case UART_V1_PARSE_FRAME:
+            port.frames_ok++;
+            on_payload_valid(port, port.parser.payload);
             break;
-
-        case PARSER_WAIT_SOF2:
-            if (byte == UART_V1_SOF2) {
-                parser_state = PARSER_WAIT_LEN;
-            } else if (byte != UART_V1_SOF1) {
-                parser_state = PARSER_WAIT_SOF1;
+        case UART_V1_PARSE_DROP_LEN:
+            stats.drop_len++;
+            port.drop_len++;
+            if (!port.drop_logged_len) {
+                port.drop_logged_len = true;
+                pc_log("[UART_DROP] port=%u reason=len\r\n", esp_port_index(port));
             }
             break;
-
-        case PARSER_WAIT_LEN:
-            parser_len = byte;
-            if (parser_len != UART_V1_PAYLOAD_LEN) {
-                stats.drop_len++;
-                if (!drop_logged_len) {
-                    drop_logged_len = true;
-                    pc_log("[UART_DROP] reason=len\r\n");
-                }
-                parser_state = (byte == UART_V1_SOF1) ? PARSER_WAIT_SOF2 : PARSER_WAIT_SOF1;
-                break;
+        case UART_V1_PARSE_DROP_CRC:
+            stats.drop_crc++;
+            port.drop_crc++;
+            if (!port.drop_logged_crc) {
+                port.drop_logged_crc = true;
+                pc_log("[UART_DROP] port=%u reason=crc\r\n", esp_port_index(port));
             }
-            payload_index = 0U;
-            parser_state = PARSER_READ_PAYLOAD;
             break;
-
-        case PARSER_READ_PAYLOAD:
-            payload[payload_index++] = byte;
-            if (payload_index >= UART_V1_PAYLOAD_LEN) {
-                crc_index = 0U;
-                parser_state = PARSER_READ_CRC;
-            }
+        case UART_V1_PARSE_MORE:
             break;
+    }
+    TRACE_END(TRACE_UART_BYTE);
+}
 
-        case PARSER_READ_CRC:
-            crc_rx[crc_index++] = byte;
-            if (crc_index >= 2U) {
-                uint8_t crc_input[1U + UART_V1_PAYLOAD_LEN];
-                crc_input[0] = parser_len;
-                memcpy(&crc_input[1], payload, UART_V1_PAYLOAD_LEN);
-                uint16_t crc_calc = uart_v1_crc16_ccitt(crc_input, sizeof(crc_input));
-                uint16_t crc_recv = ((uint16_t)crc_rx[0] << 8) | (uint16_t)crc_rx[1];
-                if (crc_calc != crc_recv) {
-                    stats.drop_crc++;
-                    if (!drop_logged_crc) {
-                        drop_logged_crc = true;
-                        pc_log("[UART_DROP] reason=crc\r\n");
-                    }
-                } else {
-                    on_payload_valid(payload);
-                }
-                parser_reset();
-            }
-            break;
+// Returns true if the port still has bytes after its quantum.
+bool drain_esp_port(esp_port_t &port, size_t quantum)
+{
+    uint8_t byte = 0;
+    for (size_t n = 0; n < quantum; ++n) {
+        if (!rx_ring_pop(&port.rx, &byte)) {
+            return false;
+        }
+        port.rx_bytes++;
+        if (lora_joined) {
+            handle_uart_byte(port, byte);
+        }
     }
+    return !rx_ring_empty(&port.rx);
 }
 
-void poll_uart_esp()
+// Ports are served round-robin, one frame's worth of bytes per turn, starting
+// one port further on each pass so a busy or noisy link cannot hold back the
+// others. A long burst is split over several queue events so LoRa events
+// still run in between. Bytes received before join are discarded, as the
+// LoRa side cannot forward them anyway.
+void drain_esp_ports()
 {
-    if (!lora_joined) {
-        return;
+    for (size_t round = 0; round < ESP_DRAIN_ROUNDS; ++round) {
+        bool more = false;
+        for (size_t k = 0; k < ESP_PORT_COUNT; ++k) {
+            more |= drain_esp_port(esp_ports[(esp_port_next + k) % ESP_PORT_COUNT], ESP_PORT_QUANTUM);
+        }
+        esp_port_next = (esp_port_next + 1U) % ESP_PORT_COUNT;
+        if (!more) {
+            return;
+        }
+    }
+    // On a full queue the rest waits for the next RX interrupt.
+    if (ev_queue.call(drain_esp_ports) == 0) {
+        ev_post_fail++;
     }
+}
+
+// Runs in the event queue once per RX burst, whichever port it came from.
+// The latency is from the RX interrupt on, so it leaves out the Stop exit
+// before it; wake_probe_pin shows that part on a scope.
+void drain_uart_esp()
+{
+    if (MBED_CONF_APP_WAKE_PROBE_PIN != NC) {
+        wake_probe = 0;
+    }
+    uint32_t latency = power_now_us() - esp_rx_irq_us;
+    if (latency > irq_dispatch_max_us) {
+        irq_dispatch_max_us = latency;
+    }
+    irq_dispatch_avg_us = (irq_dispatch_avg_us == 0U) ? latency : (irq_dispatch_avg_us * 7U + latency) / 8U;
+    esp_rx_pending = false;
+    drain_esp_ports();
+}
 
+void on_esp_rx_irq(esp_port_t *port)
+{
+    if (MBED_CONF_APP_WAKE_PROBE_PIN != NC && !esp_rx_pending) {
+        wake_probe = 1;
+    }
+    uint8_t byte = 0;
+    while (port->serial->readable() && port->serial->read(&byte, 1) == 1) {
+        rx_ring_push(&port->rx, byte);
+    }
+    // A failed post must not leave the flag set, or this path stays deaf.
+    if (!esp_rx_pending) {
+        esp_rx_pending = true;
+        esp_rx_irq_us = power_now_us();
+        if (ev_queue.call(drain_uart_esp) == 0) {
+            esp_rx_pending = false;
+            ev_post_fail++;
+        }
+    }
+}
+
+void on_pc_rx_irq()
+{
     uint8_t byte = 0;
-    while (true) {
-        ssize_t n = esp.read(&byte, 1);
-        if (n == 1) {
-            handle_uart_byte(byte);
-            continue;
+    while (pc.readable() && pc.read(&byte, 1) == 1) {
+        rx_ring_push(&pc_rx, byte);
+    }
+    if (!pc_rx_pending) {
+        pc_rx_pending = true;
+        if (ev_queue.call(poll_pc_console) == 0) {
+            pc_rx_pending = false;
+            ev_post_fail++;
         }
-        break;
+    }
+}
+
+// RX is interrupt driven so the event queue has no periodic work while idle
+// and the MCU can stay in Stop mode; attach() takes a deep-sleep lock per
+// serial, released here once the USART is able to wake the core itself. An
+// ESP port on USART4/5 keeps its lock, so the bridge then idles in Sleep.
+void setup_serial_wakeup()
+{
+    for (esp_port_t &port : esp_ports) {
+        port.serial->attach(mbed::callback(on_esp_rx_irq, &port), SerialBase::RxIrq);
+    }
+    pc.attach(on_pc_rx_irq, SerialBase::RxIrq);
+#if defined(TARGET_STM32L0)
+    stop_mode_wakeup = true;
+    for (esp_port_t &port : esp_ports) {
+        if (stm32l0_uart_enable_stop_wakeup(stm32l0_uart_from_rx_pin(port.rx_pin), UART_BAUDRATE)) {
+            sleep_manager_unlock_deep_sleep();
+        } else {
+            stop_mode_wakeup = false;
+            pc_log("[POWER] port=%u cannot wake from Stop\r\n", esp_port_index(port));
+        }
+    }
+    if (stm32l0_uart_enable_stop_wakeup(USART2, UART_BAUDRATE)) {
+        sleep_manager_unlock_deep_sleep();
+    }
+#endif
+}
+
+void join_status_tick()
+{
+    if (join_in_progress && !lora_joined) {
+        led_rx = !led_rx;
+        pc_log("JOIN PENDING...\r\n");
+    }
+}
+
+void stop_join_tick()
+{
+    if (join_tick_id != 0) {
+        ev_queue.cancel(join_tick_id);
+        join_tick_id = 0;
     }
 }
 
@@ -265,29 +1198,47 @@ void lora_event_handler(lorawan_event_t event)
         case CONNECTED:
             lora_joined = true;
             join_in_progress = false;
+            stop_join_tick();
+            led_rx = 0;
             pc_log("LoRaWAN JOIN SUCCESS\r\n");
+            apply_datarate_caps(false);
+            request_time_sync();
             break;
         case TX_DONE:
             pc_log("TX DONE\r\n");
+            clamp_adr_datarate();
+            on_policy_tx_done(true);
+            on_confirm_tx_done(true);
+            if (summary_sent < summary_count) {
+                ev_queue.call(send_summary_chunk);
+            }
             break;
         case JOIN_FAILURE:
             lora_joined = false;
             join_in_progress = false;
+            stop_join_tick();
             pc_log("JOIN FAILED\r\n");
             break;
         case DISCONNECTED:
             lora_joined = false;
             join_in_progress = false;
+            stop_join_tick();
             pc_log("DISCONNECTED\r\n");
             break;
         case RX_DONE:
             pc_log("RX DONE\r\n");
+            lora_receive();
+            break;
+        case DEVICE_TIME_SYNCHED:
+            on_time_synched();
             break;
         case TX_TIMEOUT:
         case TX_ERROR:
         case TX_CRYPTO_ERROR:
         case TX_SCHEDULING_ERROR:
             pc_log("TX ERROR event=%d\r\n", (int)event);
+            on_policy_tx_done(false);
+            on_confirm_tx_done(false);
             break;
         default:
             pc_log("LORA EVENT=%d\r\n", (int)event);
@@ -295,24 +1246,22 @@ void lora_event_handler(lorawan_event_t event)
     }
 }
 
-void join_status_tick()
-{
-    if (join_in_progress && !lora_joined) {
-        pc_log("JOIN PENDING...\r\n");
-    }
-}
-
 }  // namespace
 
 int main()
 {
     pc.set_blocking(true);
-    esp.set_blocking(false);
+    esp_ports_init();
+    frame_pipeline_bind(frame_pipeline, &bridge_env);
+    power_timer.start();
+#if TRACE_POINTS_ENABLED
+    trace_init();
+#endif
 
     const char boot_msg[] = "STM32 BOOT\r\n";
     pc.write(boot_msg, sizeof(boot_msg) - 1U);
     pc_log("STM32 ready - UART -> TTN bridge\r\n");
-    pc_log("UART ESP on PA9/PA10 @115200\r\n");
+    pc_log("UART ESP on PA9/PA10 @115200 (%u port%s)\r\n", (unsigned)ESP_PORT_COUNT, (ESP_PORT_COUNT > 1U) ? "s" : "");
     print_hex("DEV_EUI=", TTN_DEV_EUI, 8);
     print_hex("APP_EUI=", TTN_APP_EUI, 8);
 
@@ -322,11 +1271,16 @@ int main()
         return -1;
     }
     callbacks.events = mbed::callback(lora_event_handler);
+    callbacks.link_check_resp = mbed::callback(on_link_check);
     lorawan.add_app_callbacks(&callbacks);
-    lorawan_status_t adr = lorawan.enable_adaptive_datarate();
+    config_load();
+    confirm_policy_reset(&confirm_policy, config.confirm_budget_d, config.confirm_every_batch, now_ms());
+    lorawan.set_confirmed_msg_retries(CONFIRM_MSG_RETRIES);
+    lorawan_status_t adr = (config.dr_mode == DR_V1_MODE_ADR) ? lorawan.enable_adaptive_datarate() : lorawan.disable_adaptive_datarate();
     if (adr != LORAWAN_STATUS_OK) {
-        pc_log("ADR enable failed: %d\r\n", (int)adr);
+        pc_log("ADR setup failed: %d\r\n", (int)adr);
     }
+    forward_config_to_esp();
 
     lorawan_connect_t params;
     params.connect_type = LORAWAN_CONNECTION_OTAA;
@@ -342,11 +1296,13 @@ int main()
         pc_log("Join start failed: %d\r\n", (int)ret);
     } else {
         join_in_progress = true;
+        join_tick_id = ev_queue.call_every(JOIN_TICK_PERIOD, join_status_tick);
     }
 
-    ev_queue.call_every(UART_POLL_PERIOD, poll_uart_esp);
-    ev_queue.call_every(1s, blink);
-    ev_queue.call_every(10s, join_status_tick);
+    setup_serial_wakeup();
+    schedule_stats();
+    schedule_window();
+    ev_queue.call_every(TIME_RESYNC_PERIOD, request_time_sync);
     ev_queue.dispatch_forever();
     return 0;
 }
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-node link analytics derived from the UART frame counter: a jump of more
+// than one is a gap (frames lost between the ESP and the bridge), an equal
+// counter is a duplicate, a lower one is stale (replay or ESP restart).
+typedef enum {
+    LINK_FRAME_NEW = 0,
+    LINK_FRAME_DUPLICATE,
+    LINK_FRAME_STALE
+} link_frame_class_t;
+
+typedef struct {
+    uint32_t expected_next;
+    uint32_t lost;
+    uint32_t gaps;
+    uint32_t duplicates;
+    uint32_t stale;
+    uint32_t last_arrival_ms;
+    uint32_t iat_avg_ms;
+    uint32_t iat_max_ms;
+    uint8_t valid;
+} node_link_stats_t;
+
+// Inter-arrival average is an EWMA with weight 1/8.
+#define LINK_IAT_EWMA_SHIFT       3
+
+static inline link_frame_class_t node_link_on_frame(node_link_stats_t *s, uint32_t counter, uint32_t now_ms)
+{
+    if (s->valid) {
+        uint32_t last = s->expected_next - 1U;
+        if (counter == last) {
+            s->duplicates++;
+            return LINK_FRAME_DUPLICATE;
+        }
+        if (counter < last) {
+            s->stale++;
+            return LINK_FRAME_STALE;
+        }
+        if (counter != s->expected_next) {
+            s->gaps++;
+            s->lost += counter - s->expected_next;
+        }
+
+        uint32_t iat = now_ms - s->last_arrival_ms;
+        if (s->iat_avg_ms == 0U) {
+            s->iat_avg_ms = iat;
+        } else {
+            s->iat_avg_ms = s->iat_avg_ms - (s->iat_avg_ms >> LINK_IAT_EWMA_SHIFT) + (iat >> LINK_IAT_EWMA_SHIFT);
+        }
+        if (iat > s->iat_max_ms) {
+            s->iat_max_ms = iat;
+        }
+    }
+
+    s->valid = 1U;
+    s->expected_next = counter + 1U;
+    s->last_arrival_ms = now_ms;
+    return LINK_FRAME_NEW;
+}
+
+// Share of frames lost, in 1/10000 (basis points), over received + lost.
+static inline uint32_t node_link_loss_bp(const node_link_stats_t *s, uint32_t received)
+{
+    uint32_t total = received + s->lost;
+    if (total == 0U) {
+        return 0U;
+    }
+    return (uint32_t)(((uint64_t)s->lost * 10000U) / total);
+}
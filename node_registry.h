@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Fixed-capacity open-addressing table mapping a node ID to a per-node slot.
+// Linear probing; entries are only removed all at once by clear(). The load
+// is capped at 3/4 of Capacity; past that, new nodes are refused rather than
+// evicting a known one, whose slot holds its anti-replay counter. Slot must
+// be trivially copyable; new slots start zeroed.
+template <typename Key, typename Slot, size_t Capacity>
+class node_registry {
+    static_assert(Capacity >= 4 && (Capacity & (Capacity - 1U)) == 0U, "Capacity must be a power of two >= 4");
+
+public:
+    static constexpr size_t max_nodes = Capacity - Capacity / 4U;
+
+    node_registry()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        memset(used_, 0, sizeof(used_));
+        count_ = 0U;
+        rejected_ = 0U;
+    }
+
+    Slot *find(Key id)
+    {
+        size_t i = 0U;
+        if (!lookup(id, &i)) {
+            return nullptr;
+        }
+        return &entries_[i].slot;
+    }
+
+    // Returns the slot of id, creating a zeroed one if needed (*inserted is
+    // then set), or nullptr if id is new and the table is full.
+    Slot *find_or_insert(Key id, bool *inserted)
+    {
+        size_t i = 0U;
+        *inserted = false;
+        if (lookup(id, &i)) {
+            return &entries_[i].slot;
+        }
+
+        if (count_ >= max_nodes) {
+            rejected_++;
+            return nullptr;
+        }
+        set_used(i);
+        entries_[i].id = id;
+        memset(&entries_[i].slot, 0, sizeof(Slot));
+        count_++;
+        *inserted = true;
+        return &entries_[i].slot;
+    }
+
+    template <typename F>
+    void for_each(F fn)
+    {
+        for (size_t i = 0; i < Capacity; ++i) {
+            if (is_used(i)) {
+                fn(entries_[i].id, entries_[i].slot);
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return count_;
+    }
+
+    // New nodes refused because the table was full.
+    uint32_t rejected() const
+    {
+        return rejected_;
+    }
+
+private:
+    struct entry_t {
+        Key id;
+        Slot slot;
+    };
+
+    static constexpr unsigned log2_of(size_t n)
+    {
+        return (n <= 1U) ? 0U : 1U + log2_of(n >> 1);
+    }
+
+    static size_t home(Key id)
+    {
+        // Fibonacci hashing: the top bits of id * 2^32/phi index the table.
+        uint32_t h = (uint32_t)((uint32_t)id * 2654435769UL);
+        return (size_t)(h >> (32U - log2_of(Capacity)));
+    }
+
+    bool is_used(size_t i) const
+    {
+        return (used_[i >> 3] & (uint8_t)(1U << (i & 7U))) != 0U;
+    }
+
+    void set_used(size_t i)
+    {
+        used_[i >> 3] |= (uint8_t)(1U << (i & 7U));
+    }
+
+    // Index of id if present, otherwise of the free bucket where it goes.
+    bool lookup(Key id, size_t *index) const
+    {
+        size_t i = home(id);
+        while (is_used(i)) {
+            if (entries_[i].id == id) {
+                *index = i;
+                return true;
+            }
+            i = (i + 1U) & (Capacity - 1U);
+        }
+        *index = i;
+        return false;
+    }
+
+    entry_t entries_[Capacity];
+    uint8_t used_[(Capacity + 7U) / 8U];
+    size_t count_;
+    uint32_t rejected_;
+};
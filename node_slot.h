@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "gps_clock.h"
+#include "node_analytics.h"
+#include "occupancy_window.h"
+
+// Per-node state held in the node registry: link analytics, occupancy
+// window, uptime to GPS time mapping and the heartbeat suppression gate.
+typedef struct {
+    node_link_stats_t link;
+    occupancy_window_t window;
+    node_uptime_map_t uptime_map;
+    uint32_t rx_ok;
+    uint32_t hb_last_tx_s;
+    uint8_t hb_last_luma;
+    uint8_t hb_valid;
+} node_slot_t;
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming per-node occupancy window. Durations are integrated from the
+// state carried by the previous frame up to the next frame (or the window
+// end), so a node keeps accruing occupied / low-light time between frames.
+typedef struct {
+    uint32_t last_ms;
+    uint32_t occupied_ms;
+    uint32_t low_light_ms;
+    uint32_t luma_sum;
+    uint16_t samples;
+    uint16_t transitions;
+    uint8_t luma_min;
+    uint8_t luma_max;
+    uint8_t occupied;
+    uint8_t low_light;
+    uint8_t valid;
+} occupancy_window_t;
+
+typedef struct {
+    uint32_t occupied_ms;
+    uint32_t low_light_ms;
+    uint16_t transitions;
+    uint8_t luma_min;
+    uint8_t luma_max;
+    uint8_t luma_mean;
+    uint8_t occupied;
+} occupancy_summary_t;
+
+static inline void occupancy_window_advance(occupancy_window_t *w, uint32_t now_ms)
+{
+    uint32_t dt = now_ms - w->last_ms;
+    if (w->occupied) {
+        w->occupied_ms += dt;
+    }
+    if (w->low_light) {
+        w->low_light_ms += dt;
+    }
+    w->last_ms = now_ms;
+}
+
+static inline void occupancy_window_on_frame(occupancy_window_t *w, bool occupied, bool low_light, uint8_t luma, uint32_t now_ms)
+{
+    if (w->valid) {
+        occupancy_window_advance(w, now_ms);
+        if ((w->occupied != 0U) != occupied && w->transitions < 0xFFFFU) {
+            w->transitions++;
+        }
+    } else {
+        w->valid = 1U;
+        w->last_ms = now_ms;
+    }
+
+    if (w->samples == 0U || luma < w->luma_min) {
+        w->luma_min = luma;
+    }
+    if (w->samples == 0U || luma > w->luma_max) {
+        w->luma_max = luma;
+    }
+    // The mean covers the first 0xFFFF frames of the window; min/max all of them.
+    if (w->samples < 0xFFFFU) {
+        w->luma_sum += luma;
+        w->samples++;
+    }
+    w->occupied = occupied ? 1U : 0U;
+    w->low_light = low_light ? 1U : 0U;
+}
+
+// Closes the window at now_ms into *out and starts the next one, keeping the
+// current occupancy / low-light state. Returns false for a node never seen.
+static inline bool occupancy_window_close(occupancy_window_t *w, uint32_t now_ms, occupancy_summary_t *out)
+{
+    if (!w->valid) {
+        return false;
+    }
+    occupancy_window_advance(w, now_ms);
+
+    out->occupied_ms = w->occupied_ms;
+    out->low_light_ms = w->low_light_ms;
+    out->transitions = w->transitions;
+    out->occupied = w->occupied;
+    if (w->samples != 0U) {
+        out->luma_min = w->luma_min;
+        out->luma_max = w->luma_max;
+        out->luma_mean = (uint8_t)(w->luma_sum / w->samples);
+    } else {
+        out->luma_min = 0U;
+        out->luma_max = 0U;
+        out->luma_mean = 0U;
+    }
+
+    w->occupied_ms = 0U;
+    w->low_light_ms = 0U;
+    w->luma_sum = 0U;
+    w->samples = 0U;
+    w->transitions = 0U;
+    return true;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <type_traits>
+
+// Compile-time stage chain for the frame data path. A pipeline is a list of
+// stage types run in order on a caller-defined context; each stage is held
+// by value and called directly (no virtual calls, no heap), so a stage that
+// is not in the list is not compiled in at all. A stage is any type with
+//
+//     static const char *name();
+//     stage_verdict_t process(Ctx &ctx);
+//
+// STAGE_PASS hands the context to the next stage, STAGE_DROP ends the run
+// (filtered out) and STAGE_DONE ends it too (a sink took the frame). The
+// pipeline counts, per stage, the frames it saw and how they left, so stages
+// keep only their own state and can be driven on the host without the
+// firmware around them.
+typedef enum {
+    STAGE_PASS = 0,
+    STAGE_DROP,
+    STAGE_DONE
+} stage_verdict_t;
+
+typedef struct {
+    uint32_t in;
+    uint32_t dropped;
+    uint32_t done;
+} stage_stats_t;
+
+template <typename Ctx, typename... Stages>
+class pipeline;
+
+template <typename Ctx>
+class pipeline<Ctx> {
+public:
+    static constexpr size_t size = 0U;
+
+    stage_verdict_t run(Ctx &)
+    {
+        return STAGE_PASS;
+    }
+
+    // fn(const char *name, const stage_stats_t &stats), in pipeline order.
+    template <typename F>
+    void for_each(F &&) const
+    {
+    }
+
+    void reset_stats()
+    {
+    }
+
+    // fn(stage) on every stage instance, e.g. to hand them their dependencies.
+    template <typename F>
+    void for_each_stage(F &&)
+    {
+    }
+};
+
+template <typename Ctx, typename Head, typename... Tail>
+class pipeline<Ctx, Head, Tail...> {
+public:
+    static constexpr size_t size = 1U + sizeof...(Tail);
+
+    stage_verdict_t run(Ctx &ctx)
+    {
+        stats_.in++;
+        stage_verdict_t v = head_.process(ctx);
+        if (v == STAGE_PASS) {
+            return tail_.run(ctx);
+        }
+        if (v == STAGE_DROP) {
+            stats_.dropped++;
+        } else {
+            stats_.done++;
+        }
+        return v;
+    }
+
+    // The stage instance of type S, e.g. to configure it or read its state.
+    template <typename S>
+    S &stage()
+    {
+        return get(static_cast<S *>(nullptr), std::is_same<S, Head>());
+    }
+
+    template <typename S>
+    const stage_stats_t &stats() const
+    {
+        return get_stats(static_cast<S *>(nullptr), std::is_same<S, Head>());
+    }
+
+    template <typename F>
+    void for_each(F &&fn) const
+    {
+        fn(Head::name(), stats_);
+        tail_.for_each(fn);
+    }
+
+    void reset_stats()
+    {
+        stats_ = stage_stats_t();
+        tail_.reset_stats();
+    }
+
+    template <typename F>
+    void for_each_stage(F &&fn)
+    {
+        fn(head_);
+        tail_.for_each_stage(fn);
+    }
+
+private:
+    template <typename S>
+    S &get(S *, std::true_type)
+    {
+        return head_;
+    }
+
+    template <typename S>
+    S &get(S *, std::false_type)
+    {
+        return tail_.template stage<S>();
+    }
+
+    template <typename S>
+    const stage_stats_t &get_stats(S *, std::true_type) const
+    {
+        return stats_;
+    }
+
+    template <typename S>
+    const stage_stats_t &get_stats(S *, std::false_type) const
+    {
+        return tail_.template stats<S>();
+    }
+
+    Head head_;
+    stage_stats_t stats_ = {};
+    pipeline<Ctx, Tail...> tail_;
+};
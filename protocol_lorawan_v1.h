@@ -0,0 +1,427 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "protocol_uart_v1.h"
+
+// FPort map of the bridge. FPort 15 carries the raw 16-byte UART payload.
+#define LORA_V1_FPORT_EVENT       15
+#define LORA_V1_FPORT_CMD         16
+#define LORA_V1_FPORT_STATS       17
+#define LORA_V1_FPORT_LINK        18
+#define LORA_V1_FPORT_SUMMARY     19
+#define LORA_V1_FPORT_BATCH       20
+#define LORA_V1_FPORT_FEC         21
+
+#define LORA_V1_VERSION           0x01
+
+// Downlink command frame on LORA_V1_FPORT_CMD:
+//   ver(1) | seq(2, BE) | { opcode(1) | args } * n | mic(4)
+// mic = AES-CMAC(TTN_CMD_KEY, ver | seq | commands), truncated to 4 bytes.
+// seq must be strictly newer (serial number arithmetic) than the last
+// accepted one; it is persisted with the configuration.
+#define DL_V1_HEADER_LEN          3
+#define DL_V1_MIC_LEN             4
+#define DL_V1_MAX_LEN             51
+
+#define DL_V1_CMD_HEARTBEAT       0x01  // u16 heartbeat period (s), forwarded to ESP
+#define DL_V1_CMD_SUPPRESS        0x02  // u8 luma delta, u16 min interval (s)
+#define DL_V1_CMD_STATS_INTERVAL  0x03  // u16 stats uplink period (s), 0 = off
+#define DL_V1_CMD_DR_CAP          0x04  // u8 DR_V1_MODE_*, u8 dr_min, u8 dr_max
+#define DL_V1_CMD_LINK_REPORT     0x05  // u8 on/off, link report follows stats uplinks
+#define DL_V1_CMD_FORWARD_MODE    0x06  // u8 FWD_V1_MODE_*, u16 summary window (s)
+#define DL_V1_CMD_TIME_BATCH      0x07  // u8 on/off, u16 max batch age (s)
+#define DL_V1_CMD_CONFIRM         0x08  // u8 acks per day (0 = off), u8 confirm every Nth batch (0 = off)
+#define DL_V1_CMD_FEC             0x09  // u8 event copies per raw uplink, 0 = off
+
+#define DL_V1_CHANGED_HEARTBEAT   (1U << 0)
+#define DL_V1_CHANGED_SUPPRESS    (1U << 1)
+#define DL_V1_CHANGED_STATS       (1U << 2)
+#define DL_V1_CHANGED_DR          (1U << 3)
+#define DL_V1_CHANGED_LINK_REPORT (1U << 4)
+#define DL_V1_CHANGED_FORWARD     (1U << 5)
+#define DL_V1_CHANGED_TIME_BATCH  (1U << 6)
+#define DL_V1_CHANGED_CONFIRM     (1U << 7)
+#define DL_V1_CHANGED_FEC         (1U << 8)
+
+#define DL_V1_HEARTBEAT_MIN_S     10U
+#define DL_V1_STATS_MIN_S         60U
+#define DL_V1_DR_MAX              5U
+#define DL_V1_WINDOW_MIN_S        60U
+#define DL_V1_BATCH_AGE_MIN_S     5U
+
+#define FWD_V1_MODE_RAW           0U  // every event on LORA_V1_FPORT_EVENT
+#define FWD_V1_MODE_SUMMARY       1U  // windowed summaries on LORA_V1_FPORT_SUMMARY only
+#define FWD_V1_MODE_BOTH          2U
+
+#define DR_V1_MODE_FIXED          0U  // dr_max, network ADR off
+#define DR_V1_MODE_ADR            1U  // network ADR, kept within dr_min..dr_max
+#define DR_V1_MODE_LINK           2U  // bridge policy from LinkCheckAns margin (datarate_policy.h)
+
+#define FEC_V1_MAX_COPIES         3U  // see build_fec_uplink_v1()
+
+typedef enum {
+    DL_V1_OK = 0,
+    DL_V1_ERR_LEN,
+    DL_V1_ERR_VER,
+    DL_V1_ERR_OPCODE,
+    DL_V1_ERR_RANGE
+} dl_v1_status_t;
+
+// Persisted as is (behind a length header); add new fields at the end only.
+typedef struct {
+    uint16_t cmd_seq;
+    uint16_t heartbeat_s;
+    uint16_t suppress_min_interval_s;
+    uint16_t stats_interval_s;
+    uint16_t window_s;
+    uint16_t batch_age_s;
+    uint8_t suppress_luma_delta;
+    uint8_t dr_mode;
+    uint8_t dr_min;
+    uint8_t dr_max;
+    uint8_t link_report_on;
+    uint8_t forward_mode;
+    uint8_t time_batch_on;
+    uint8_t confirm_budget_d;
+    uint8_t confirm_every_batch;
+    uint8_t fec_copies;
+} bridge_config_v1_t;
+
+static inline void bridge_config_v1_defaults(bridge_config_v1_t *cfg)
+{
+    cfg->cmd_seq = 0U;
+    cfg->heartbeat_s = 60U;
+    cfg->suppress_min_interval_s = 0U;
+    cfg->stats_interval_s = 0U;
+    cfg->suppress_luma_delta = 0U;
+    cfg->dr_mode = DR_V1_MODE_ADR;
+    cfg->dr_min = 0U;
+    cfg->dr_max = DL_V1_DR_MAX;
+    cfg->link_report_on = 0U;
+    cfg->forward_mode = FWD_V1_MODE_RAW;
+    cfg->window_s = 900U;
+    cfg->time_batch_on = 0U;
+    cfg->batch_age_s = 60U;
+    cfg->confirm_budget_d = 0U;
+    cfg->confirm_every_batch = 0U;
+    cfg->fec_copies = 0U;
+}
+
+static inline bool dl_v1_seq_newer(uint16_t seq, uint16_t last)
+{
+    return (int16_t)(uint16_t)(seq - last) > 0;
+}
+
+static inline uint16_t lora_v1_read_be16(const uint8_t *src)
+{
+    return (uint16_t)(((uint16_t)src[0] << 8) | (uint16_t)src[1]);
+}
+
+static inline void lora_v1_write_be16(uint8_t *dst, uint16_t value)
+{
+    dst[0] = (uint8_t)(value >> 8);
+    dst[1] = (uint8_t)value;
+}
+
+static inline size_t dl_v1_arg_len(uint8_t opcode)
+{
+    switch (opcode) {
+        case DL_V1_CMD_HEARTBEAT:      return 2U;
+        case DL_V1_CMD_SUPPRESS:       return 3U;
+        case DL_V1_CMD_STATS_INTERVAL: return 2U;
+        case DL_V1_CMD_DR_CAP:         return 3U;
+        case DL_V1_CMD_LINK_REPORT:    return 1U;
+        case DL_V1_CMD_FORWARD_MODE:   return 3U;
+        case DL_V1_CMD_TIME_BATCH:     return 3U;
+        case DL_V1_CMD_CONFIRM:        return 2U;
+        case DL_V1_CMD_FEC:            return 1U;
+        default:                       return 0U;
+    }
+}
+
+// Applies the command list of an already authenticated frame (MIC excluded)
+// to *cfg. *cfg is only written when every command is valid, so a frame is
+// applied entirely or not at all. *changed receives DL_V1_CHANGED_* bits.
+static inline dl_v1_status_t dl_v1_apply(const uint8_t *buf, size_t len, bridge_config_v1_t *cfg, uint16_t *changed)
+{
+    if (len < DL_V1_HEADER_LEN) {
+        return DL_V1_ERR_LEN;
+    }
+    if (buf[0] != LORA_V1_VERSION) {
+        return DL_V1_ERR_VER;
+    }
+
+    bridge_config_v1_t next = *cfg;
+    uint16_t mask = 0U;
+    next.cmd_seq = lora_v1_read_be16(&buf[1]);
+
+    size_t i = DL_V1_HEADER_LEN;
+    while (i < len) {
+        uint8_t opcode = buf[i++];
+        size_t arg_len = dl_v1_arg_len(opcode);
+        if (arg_len == 0U) {
+            return DL_V1_ERR_OPCODE;
+        }
+        if (i + arg_len > len) {
+            return DL_V1_ERR_LEN;
+        }
+        const uint8_t *arg = &buf[i];
+        i += arg_len;
+
+        switch (opcode) {
+            case DL_V1_CMD_HEARTBEAT:
+                next.heartbeat_s = lora_v1_read_be16(arg);
+                if (next.heartbeat_s < DL_V1_HEARTBEAT_MIN_S) {
+                    return DL_V1_ERR_RANGE;
+                }
+                mask |= DL_V1_CHANGED_HEARTBEAT;
+                break;
+            case DL_V1_CMD_SUPPRESS:
+                next.suppress_luma_delta = arg[0];
+                next.suppress_min_interval_s = lora_v1_read_be16(&arg[1]);
+                mask |= DL_V1_CHANGED_SUPPRESS;
+                break;
+            case DL_V1_CMD_STATS_INTERVAL:
+                next.stats_interval_s = lora_v1_read_be16(arg);
+                if (next.stats_interval_s != 0U && next.stats_interval_s < DL_V1_STATS_MIN_S) {
+                    return DL_V1_ERR_RANGE;
+                }
+                mask |= DL_V1_CHANGED_STATS;
+                break;
+            case DL_V1_CMD_DR_CAP:
+                next.dr_mode = arg[0];
+                next.dr_min = arg[1];
+                next.dr_max = arg[2];
+                if (next.dr_mode > DR_V1_MODE_LINK || next.dr_min > next.dr_max || next.dr_max > DL_V1_DR_MAX) {
+                    return DL_V1_ERR_RANGE;
+                }
+                mask |= DL_V1_CHANGED_DR;
+                break;
+            case DL_V1_CMD_LINK_REPORT:
+                next.link_report_on = (arg[0] != 0U) ? 1U : 0U;
+                mask |= DL_V1_CHANGED_LINK_REPORT;
+                break;
+            case DL_V1_CMD_FORWARD_MODE:
+                next.forward_mode = arg[0];
+                next.window_s = lora_v1_read_be16(&arg[1]);
+                if (next.forward_mode > FWD_V1_MODE_BOTH || next.window_s < DL_V1_WINDOW_MIN_S) {
+                    return DL_V1_ERR_RANGE;
+                }
+                mask |= DL_V1_CHANGED_FORWARD;
+                break;
+            case DL_V1_CMD_TIME_BATCH:
+                next.time_batch_on = (arg[0] != 0U) ? 1U : 0U;
+                next.batch_age_s = lora_v1_read_be16(&arg[1]);
+                if (next.batch_age_s < DL_V1_BATCH_AGE_MIN_S) {
+                    return DL_V1_ERR_RANGE;
+                }
+                mask |= DL_V1_CHANGED_TIME_BATCH;
+                break;
+            case DL_V1_CMD_CONFIRM:
+                next.confirm_budget_d = arg[0];
+                next.confirm_every_batch = arg[1];
+                mask |= DL_V1_CHANGED_CONFIRM;
+                break;
+            case DL_V1_CMD_FEC:
+                next.fec_copies = arg[0];
+                if (next.fec_copies > FEC_V1_MAX_COPIES) {
+                    return DL_V1_ERR_RANGE;
+                }
+                mask |= DL_V1_CHANGED_FEC;
+                break;
+        }
+    }
+    // The link report rides on the stats timer; it cannot be on without it.
+    if (next.link_report_on != 0U && next.stats_interval_s == 0U) {
+        return DL_V1_ERR_RANGE;
+    }
+
+    *cfg = next;
+    *changed = mask;
+    return DL_V1_OK;
+}
+
+// Stats uplink on LORA_V1_FPORT_STATS:
+//   ver(1) | rx_ok | drop_crc | drop_len | drop_replay | drop_ver | tx_ok | tx_fail | suppressed
+// Counters are the low 16 bits (BE) of the bridge runtime counters.
+#define STATS_V1_COUNTERS         8
+#define STATS_V1_LEN              (1 + 2 * STATS_V1_COUNTERS)
+
+static inline size_t build_stats_uplink_v1(const uint32_t counters[STATS_V1_COUNTERS], uint8_t out[STATS_V1_LEN])
+{
+    out[0] = LORA_V1_VERSION;
+    for (size_t i = 0; i < STATS_V1_COUNTERS; ++i) {
+        lora_v1_write_be16(&out[1 + 2 * i], (uint16_t)counters[i]);
+    }
+    return STATS_V1_LEN;
+}
+
+// Link report uplink on LORA_V1_FPORT_LINK:
+//   ver(1) | { node_id(2) | lost(2) | gaps(2) | duplicates(1) | iat_avg_s(2) } * n
+// Counters are saturated to their field width. Nodes that do not fit are
+// reported in the next uplink.
+#define LINK_V1_RECORD_LEN        9
+#define LINK_V1_MAX_RECORDS       5
+
+typedef struct {
+    uint16_t node_id;
+    uint32_t lost;
+    uint32_t gaps;
+    uint32_t duplicates;
+    uint32_t iat_avg_ms;
+} link_report_record_v1_t;
+
+static inline uint16_t lora_v1_sat16(uint32_t value)
+{
+    return (value > 0xFFFFU) ? 0xFFFFU : (uint16_t)value;
+}
+
+static inline size_t build_link_report_v1(const link_report_record_v1_t *records, size_t n, uint8_t *out)
+{
+    out[0] = LORA_V1_VERSION;
+    size_t pos = 1U;
+    for (size_t i = 0; i < n; ++i) {
+        const link_report_record_v1_t *r = &records[i];
+        lora_v1_write_be16(&out[pos], r->node_id);
+        lora_v1_write_be16(&out[pos + 2], lora_v1_sat16(r->lost));
+        lora_v1_write_be16(&out[pos + 4], lora_v1_sat16(r->gaps));
+        out[pos + 6] = (r->duplicates > 0xFFU) ? 0xFFU : (uint8_t)r->duplicates;
+        lora_v1_write_be16(&out[pos + 7], lora_v1_sat16(r->iat_avg_ms / 1000U));
+        pos += LINK_V1_RECORD_LEN;
+    }
+    return pos;
+}
+
+// Occupancy summary uplink on LORA_V1_FPORT_SUMMARY, one window split over
+// as many uplinks as needed:
+//   ver(1) | window_seq(1) | window_s(2) |
+//   { node_id(2) | occupied_s(2) | low_light_s(2) | transitions(1) |
+//     luma_min(1) | luma_max(1) | luma_mean(1) | state(1) } * n
+// state bit 0 = occupied at window end. transitions saturates at 255.
+#define SUMMARY_V1_HEADER_LEN     4
+#define SUMMARY_V1_RECORD_LEN     11
+#define SUMMARY_V1_MAX_RECORDS    4
+
+typedef struct {
+    uint16_t node_id;
+    uint32_t occupied_ms;
+    uint32_t low_light_ms;
+    uint16_t transitions;
+    uint8_t luma_min;
+    uint8_t luma_max;
+    uint8_t luma_mean;
+    uint8_t occupied;
+} summary_record_v1_t;
+
+static inline size_t build_summary_uplink_v1(uint8_t window_seq, uint16_t window_s,
+                                             const summary_record_v1_t *records, size_t n, uint8_t *out)
+{
+    out[0] = LORA_V1_VERSION;
+    out[1] = window_seq;
+    lora_v1_write_be16(&out[2], window_s);
+    size_t pos = SUMMARY_V1_HEADER_LEN;
+    for (size_t i = 0; i < n; ++i) {
+        const summary_record_v1_t *r = &records[i];
+        lora_v1_write_be16(&out[pos], r->node_id);
+        lora_v1_write_be16(&out[pos + 2], lora_v1_sat16(r->occupied_ms / 1000U));
+        lora_v1_write_be16(&out[pos + 4], lora_v1_sat16(r->low_light_ms / 1000U));
+        out[pos + 6] = (r->transitions > 0xFFU) ? 0xFFU : (uint8_t)r->transitions;
+        out[pos + 7] = r->luma_min;
+        out[pos + 8] = r->luma_max;
+        out[pos + 9] = r->luma_mean;
+        out[pos + 10] = r->occupied ? 0x01U : 0x00U;
+        pos += SUMMARY_V1_RECORD_LEN;
+    }
+    return pos;
+}
+
+// Timestamped event batch on LORA_V1_FPORT_BATCH, replacing per-event FPort
+// 15 uplinks once the bridge clock is synced:
+//   ver(1) | base_gps_s(4) |
+//   { node_id(1) | msg_type(1) | flags(1) | luma(1) | occupied(1) |
+//     stable_count(1) | raw_count(1) | counter_lo(2) | dt_s(2) } * n
+// Event time = base_gps_s + dt_s (GPS epoch seconds). uptime_s is not sent;
+// counter_lo is the low 16 bits of the UART counter.
+#define BATCH_V1_HEADER_LEN       5
+#define BATCH_V1_EVENT_LEN        11
+#define BATCH_V1_MAX_LEN          51
+#define BATCH_V1_MAX_EVENTS       ((BATCH_V1_MAX_LEN - BATCH_V1_HEADER_LEN) / BATCH_V1_EVENT_LEN)
+
+static inline size_t batch_v1_begin(uint8_t *out, uint32_t base_gps_s)
+{
+    out[0] = LORA_V1_VERSION;
+    uart_v1_write_be32(&out[1], base_gps_s);
+    return BATCH_V1_HEADER_LEN;
+}
+
+static inline size_t batch_v1_append(uint8_t *out, size_t pos, const vision_uart_payload_v1_t *ev, uint16_t dt_s)
+{
+    out[pos] = ev->node_id;
+    out[pos + 1] = ev->msg_type;
+    out[pos + 2] = ev->flags;
+    out[pos + 3] = ev->luma;
+    out[pos + 4] = ev->occupied;
+    out[pos + 5] = ev->stable_count;
+    out[pos + 6] = ev->raw_count;
+    lora_v1_write_be16(&out[pos + 7], (uint16_t)ev->counter);
+    lora_v1_write_be16(&out[pos + 9], dt_s);
+    return pos + BATCH_V1_EVENT_LEN;
+}
+
+// Raw event with redundancy on LORA_V1_FPORT_FEC, replacing FPort 15 when
+// FEC is on:
+//   ver(1) | event(16, as on FPort 15) |
+//   { node_id(1) | msg_type(1) | flags(1) | luma(1) | counter_lo(2) | age_s(2) } * n
+// Copies are the n events forwarded before this one, newest first, whether
+// or not their own uplink went out. flags bit 7 carries occupied; age_s is
+// the bridge time between that event and this uplink (saturated), so its time
+// is the uplink's receive time - age_s. With 3 copies the frame is 41 bytes,
+// under the 51-byte limit of DR0-2 with room for MAC commands.
+#define FEC_V1_HEADER_LEN         (1 + UART_V1_PAYLOAD_LEN)
+#define FEC_V1_COPY_LEN           8
+#define FEC_V1_MAX_LEN            (FEC_V1_HEADER_LEN + FEC_V1_COPY_LEN * FEC_V1_MAX_COPIES)
+#define FEC_V1_FLAG_OCCUPIED      (1U << 7)
+
+typedef struct {
+    uint8_t node_id;
+    uint8_t msg_type;
+    uint8_t flags;
+    uint8_t luma;
+    uint8_t occupied;
+    uint16_t counter_lo;
+    uint16_t age_s;
+} fec_copy_v1_t;
+
+static inline size_t build_fec_uplink_v1(const uint8_t event[UART_V1_PAYLOAD_LEN], const fec_copy_v1_t *copies,
+                                         size_t n, uint8_t *out)
+{
+    out[0] = LORA_V1_VERSION;
+    memcpy(&out[1], event, UART_V1_PAYLOAD_LEN);
+    size_t pos = FEC_V1_HEADER_LEN;
+    for (size_t i = 0; i < n; ++i) {
+        const fec_copy_v1_t *c = &copies[i];
+        out[pos] = c->node_id;
+        out[pos + 1] = c->msg_type;
+        out[pos + 2] = (uint8_t)((c->flags & ~FEC_V1_FLAG_OCCUPIED) | (c->occupied ? FEC_V1_FLAG_OCCUPIED : 0U));
+        out[pos + 3] = c->luma;
+        lora_v1_write_be16(&out[pos + 4], c->counter_lo);
+        lora_v1_write_be16(&out[pos + 6], c->age_s);
+        pos += FEC_V1_COPY_LEN;
+    }
+    return pos;
+}
+
+static inline void parse_fec_copy_v1(const uint8_t *src, fec_copy_v1_t *c)
+{
+    c->node_id = src[0];
+    c->msg_type = src[1];
+    c->flags = (uint8_t)(src[2] & ~FEC_V1_FLAG_OCCUPIED);
+    c->occupied = ((src[2] & FEC_V1_FLAG_OCCUPIED) != 0U) ? 1U : 0U;
+    c->luma = src[3];
+    c->counter_lo = lora_v1_read_be16(&src[4]);
+    c->age_s = lora_v1_read_be16(&src[6]);
+}
@@ -12,6 +12,9 @@
 
 #define UART_V1_MSG_HEARTBEAT         0x01
 #define UART_V1_MSG_OCCUPANCY_CHANGED 0x02
+#define UART_V1_MSG_CONFIG            0x10
+
+#define UART_V1_NODE_BROADCAST    0xFF
 
 #define UART_V1_FLAG_LOW_LIGHT    (1U << 0)
 
@@ -28,6 +31,17 @@ typedef struct __attribute__((packed)) {
     uint32_t uptime_s;
 } vision_uart_payload_v1_t;
 
+// Bridge -> ESP configuration, same framing as vision payloads.
+typedef struct __attribute__((packed)) {
+    uint8_t ver;
+    uint8_t msg_type;
+    uint8_t node_id;
+    uint8_t suppress_luma_delta;
+    uint16_t heartbeat_s;
+    uint16_t suppress_min_interval_s;
+    uint8_t reserved[8];
+} vision_uart_config_v1_t;
+
 static inline uint16_t uart_v1_crc16_ccitt(const uint8_t *data, size_t len)
 {
     uint16_t crc = 0xFFFF;
@@ -88,15 +102,46 @@ static inline void deserialize_payload_v1(vision_uart_payload_v1_t *payload, con
     payload->uptime_s = uart_v1_read_be32(&in[12]);
 }
 
-static inline size_t build_uart_frame_v1(const vision_uart_payload_v1_t *payload, uint8_t out[UART_V1_FRAME_LEN])
+static inline void serialize_config_v1(const vision_uart_config_v1_t *config, uint8_t out[UART_V1_PAYLOAD_LEN])
+{
+    out[0] = config->ver;
+    out[1] = config->msg_type;
+    out[2] = config->node_id;
+    out[3] = config->suppress_luma_delta;
+    out[4] = (uint8_t)(config->heartbeat_s >> 8);
+    out[5] = (uint8_t)config->heartbeat_s;
+    out[6] = (uint8_t)(config->suppress_min_interval_s >> 8);
+    out[7] = (uint8_t)config->suppress_min_interval_s;
+    for (size_t i = 0; i < sizeof(config->reserved); ++i) {
+        out[8 + i] = config->reserved[i];
+    }
+}
+
+static inline size_t frame_payload_v1(const uint8_t payload[UART_V1_PAYLOAD_LEN], uint8_t out[UART_V1_FRAME_LEN])
 {
     out[0] = UART_V1_SOF1;
     out[1] = UART_V1_SOF2;
     out[2] = UART_V1_PAYLOAD_LEN;
-    serialize_payload_v1(payload, &out[3]);
+    for (size_t i = 0; i < UART_V1_PAYLOAD_LEN; ++i) {
+        out[3 + i] = payload[i];
+    }
 
     uint16_t crc = uart_v1_crc16_ccitt(&out[2], 1U + UART_V1_PAYLOAD_LEN);
     out[3 + UART_V1_PAYLOAD_LEN] = (uint8_t)(crc >> 8);
     out[4 + UART_V1_PAYLOAD_LEN] = (uint8_t)crc;
     return UART_V1_FRAME_LEN;
 }
+
+static inline size_t build_uart_frame_v1(const vision_uart_payload_v1_t *payload, uint8_t out[UART_V1_FRAME_LEN])
+{
+    uint8_t raw[UART_V1_PAYLOAD_LEN];
+    serialize_payload_v1(payload, raw);
+    return frame_payload_v1(raw, out);
+}
+
+static inline size_t build_uart_config_frame_v1(const vision_uart_config_v1_t *config, uint8_t out[UART_V1_FRAME_LEN])
+{
+    uint8_t raw[UART_V1_PAYLOAD_LEN];
+    serialize_config_v1(config, raw);
+    return frame_payload_v1(raw, out);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Byte ring filled from a serial RX interrupt and drained from the event
+// queue. Single producer / single consumer, so no lock is needed on a
+// single-core MCU: the producer only writes head, the consumer only tail.
+template <size_t Size>
+struct rx_ring_t {
+    static_assert(Size >= 2U && Size <= 32768U && (Size & (Size - 1U)) == 0U, "Size must be a power of two");
+
+    volatile uint8_t buf[Size];
+    volatile uint16_t head;
+    volatile uint16_t tail;
+    volatile uint32_t overflow;
+};
+
+template <size_t Size>
+inline void rx_ring_push(rx_ring_t<Size> *r, uint8_t byte)
+{
+    uint16_t next = (uint16_t)((r->head + 1U) & (Size - 1U));
+    if (next == r->tail) {
+        r->overflow++;
+        return;
+    }
+    r->buf[r->head] = byte;
+    r->head = next;
+}
+
+template <size_t Size>
+inline bool rx_ring_pop(rx_ring_t<Size> *r, uint8_t *byte)
+{
+    if (r->tail == r->head) {
+        return false;
+    }
+    *byte = r->buf[r->tail];
+    r->tail = (uint16_t)((r->tail + 1U) & (Size - 1U));
+    return true;
+}
+
+template <size_t Size>
+inline bool rx_ring_empty(const rx_ring_t<Size> *r)
+{
+    return r->tail == r->head;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "mbed.h"
+
+#if defined(TARGET_STM32L0)
+
+#include "hal/pinmap.h"
+#include "PeripheralPins.h"
+
+// Lets USART1/USART2 keep receiving in Stop mode: the kernel clock moves to
+// HSI16, UESM is set and the wake-up event is the start bit. HSI16 is then
+// restarted by the USART itself on the start bit, the byte is sampled
+// correctly, and the RXNE interrupt wakes the core once it is complete, so
+// the byte that woke the MCU is not lost. Must run after the serial object is
+// constructed (mbed programs the baud rate for the APB clock).
+inline bool stm32l0_uart_enable_stop_wakeup(USART_TypeDef *uart, int baudrate)
+{
+    uint32_t sel_mask;
+    uint32_t sel_hsi16;
+    if (uart == USART1) {
+        sel_mask = RCC_CCIPR_USART1SEL;
+        sel_hsi16 = RCC_CCIPR_USART1SEL_1;
+    } else if (uart == USART2) {
+        sel_mask = RCC_CCIPR_USART2SEL;
+        sel_hsi16 = RCC_CCIPR_USART2SEL_1;
+    } else {
+        // USART4/5 have no kernel clock mux and cannot run in Stop mode.
+        return false;
+    }
+
+    core_util_critical_section_enter();
+    RCC->CR |= RCC_CR_HSION;
+    while ((RCC->CR & RCC_CR_HSIRDY) == 0U) {
+    }
+    uint32_t cr1 = uart->CR1;
+    uart->CR1 = cr1 & ~USART_CR1_UE;
+    RCC->CCIPR = (RCC->CCIPR & ~sel_mask) | sel_hsi16;
+    uart->BRR = (HSI_VALUE + (uint32_t)baudrate / 2U) / (uint32_t)baudrate;
+    uart->CR3 = (uart->CR3 & ~USART_CR3_WUS) | USART_CR3_WUS_1;
+    uart->CR1 = cr1 | USART_CR1_UESM;
+    core_util_critical_section_exit();
+    return true;
+}
+
+// The USART instance mbed picked for an RX pin (UARTName is its base address).
+inline USART_TypeDef *stm32l0_uart_from_rx_pin(PinName rx)
+{
+    return (USART_TypeDef *)pinmap_peripheral(rx, PinMap_UART_RX);
+}
+
+#endif  // TARGET_STM32L0
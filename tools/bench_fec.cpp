@@ -0,0 +1,204 @@
+// Host benchmark: event delivery with FEC copies (FPort 21) over a lossy
+// uplink channel. The same event stream and loss pattern are replayed for
+// 0..FEC_V1_MAX_COPIES copies: frames are built with the firmware's
+// fec_history.h and build_fec_uplink_v1(), decoded with fec_decoder.h, and
+// every recovered event is checked against the original. Loss is independent
+// per uplink, or bursty (Gilbert-Elliott, mean burst of 3 uplinks). Exits
+// nonzero if any recovered event differs from the original.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "fec_decoder.h"
+#include "fec_history.h"
+#include "fleet_sim.h"
+
+namespace {
+
+constexpr size_t NODES = 4U;
+constexpr size_t EVENTS = 200000U;
+constexpr double EVENTS_PER_NODE_HOUR = 12.0;
+constexpr double BURST_LEN = 3.0;
+
+struct event_rec_t {
+    uint32_t t_ms;
+    vision_uart_payload_v1_t frame;
+};
+
+struct loss_model_t {
+    const char *name;
+    double loss;
+    bool bursty;
+};
+
+std::vector<event_rec_t> make_events(std::mt19937 &rng)
+{
+    std::exponential_distribution<double> gap(EVENTS_PER_NODE_HOUR * NODES / 3600.0);
+    std::uniform_int_distribution<int> node(0, (int)NODES - 1);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<uint32_t> counters(NODES, 0U);
+    std::vector<uint8_t> occupied(NODES, 0U);
+    std::vector<event_rec_t> out(EVENTS);
+    double t = 0.0;
+    for (event_rec_t &e : out) {
+        t += gap(rng);
+        size_t n = (size_t)node(rng);
+        vision_uart_payload_v1_t &f = e.frame;
+        f = {};
+        f.ver = UART_V1_VERSION;
+        occupied[n] ^= (byte(rng) < 64) ? 1U : 0U;
+        f.msg_type = (byte(rng) < 64) ? UART_V1_MSG_OCCUPANCY_CHANGED : UART_V1_MSG_HEARTBEAT;
+        f.node_id = (uint8_t)(n + 1U);
+        f.flags = (byte(rng) < 32) ? UART_V1_FLAG_LOW_LIGHT : 0U;
+        f.luma = (uint8_t)byte(rng);
+        f.occupied = occupied[n];
+        f.counter = ++counters[n];
+        f.uptime_s = (uint32_t)t;
+        e.t_ms = (uint32_t)(t * 1000.0);
+    }
+    return out;
+}
+
+// true = uplink i is lost.
+std::vector<bool> make_losses(const loss_model_t &m, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<bool> lost(EVENTS);
+    // Gilbert-Elliott with a lossless good state and an all-lost bad state:
+    // leave bad with 1/BURST_LEN, enter it so that the long-run loss is m.loss.
+    double p_exit = 1.0 / BURST_LEN;
+    double p_enter = m.loss * p_exit / (1.0 - m.loss);
+    bool bad = false;
+    for (size_t i = 0; i < EVENTS; ++i) {
+        if (m.bursty) {
+            bad = bad ? (unit(rng) >= p_exit) : (unit(rng) < p_enter);
+            lost[i] = bad;
+        } else {
+            lost[i] = unit(rng) < m.loss;
+        }
+    }
+    return lost;
+}
+
+bool same_event(const fec_event_t &d, const vision_uart_payload_v1_t &f)
+{
+    return d.node_id == f.node_id && d.counter == f.counter && d.msg_type == f.msg_type
+        && d.flags == f.flags && d.luma == f.luma && d.occupied == f.occupied;
+}
+
+struct run_result_t {
+    double delivered;
+    double recovered;
+    double delay_avg_s;
+    uint32_t delay_max_s;
+    size_t mismatches;
+    double bytes_avg;
+    double uplinks_per_s;
+};
+
+run_result_t run(const std::vector<event_rec_t> &events, const std::vector<bool> &lost, size_t copies)
+{
+    fec_history_t history;
+    fec_history_reset(&history);
+    static fec_decoder_t decoder;
+    fec_decoder_reset(&decoder);
+
+    std::vector<std::vector<uint8_t>> frames(events.size());
+    size_t bytes = 0U;
+    for (size_t i = 0; i < events.size(); ++i) {
+        uint8_t payload[UART_V1_PAYLOAD_LEN];
+        serialize_payload_v1(&events[i].frame, payload);
+        fec_copy_v1_t c[FEC_V1_MAX_COPIES];
+        size_t n = fec_history_copies(&history, copies, events[i].t_ms, c);
+        uint8_t buf[FEC_V1_MAX_LEN];
+        size_t len = build_fec_uplink_v1(payload, c, n, buf);
+        fec_history_push(&history, &events[i].frame, events[i].t_ms);
+        frames[i].assign(buf, buf + len);
+        bytes += (copies == 0U) ? UART_V1_PAYLOAD_LEN : len;  // FEC off: plain FPort 15
+    }
+
+    // Expected (node, counter) -> event index, for checking recovered copies.
+    std::vector<std::vector<size_t>> by_counter(NODES + 1U);
+    for (size_t i = 0; i < events.size(); ++i) {
+        std::vector<size_t> &v = by_counter[events[i].frame.node_id];
+        v.resize(std::max<size_t>(v.size(), events[i].frame.counter + 1U), SIZE_MAX);
+        v[events[i].frame.counter] = i;
+    }
+
+    run_result_t r = {};
+    unsigned long long delay_sum = 0U;
+    fec_event_t out[FEC_DECODER_MAX_EVENTS];
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < events.size(); ++i) {
+        if (lost[i]) {
+            continue;
+        }
+        uint32_t rx_s = events[i].t_ms / 1000U;
+        size_t n = fec_decoder_feed(&decoder, frames[i].data(), frames[i].size(), rx_s, out);
+        for (size_t k = 0; k < n; ++k) {
+            const std::vector<size_t> &v = by_counter[out[k].node_id];
+            size_t idx = (out[k].counter < v.size()) ? v[out[k].counter] : SIZE_MAX;
+            if (idx == SIZE_MAX || !same_event(out[k], events[idx].frame)) {
+                r.mismatches++;
+                continue;
+            }
+            uint32_t delay = (events[i].t_ms - events[idx].t_ms) / 1000U;  // t_ms wraps like now_ms()
+            delay_sum += delay;
+            r.delay_max_s = std::max(r.delay_max_s, delay);
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    r.delivered = 100.0 * (double)decoder.events / (double)events.size();
+    r.recovered = 100.0 * (double)decoder.recovered / (double)events.size();
+    r.delay_avg_s = (decoder.recovered != 0U) ? (double)delay_sum / (double)decoder.recovered : 0.0;
+    r.bytes_avg = (double)bytes / (double)events.size();
+    r.uplinks_per_s = (double)decoder.uplinks / secs;
+    return r;
+}
+
+}  // namespace
+
+int main()
+{
+    std::mt19937 rng(2024U);
+    std::vector<event_rec_t> events = make_events(rng);
+
+    static const loss_model_t models[] = {
+        {"iid", 0.01, false},
+        {"iid", 0.05, false},
+        {"iid", 0.10, false},
+        {"iid", 0.20, false},
+        {"iid", 0.30, false},
+        {"burst", 0.10, true},
+        {"burst", 0.20, true},
+    };
+
+    printf("events=%zu nodes=%zu, FPort 21 = 1 + 16 + 8 per copy bytes\n", EVENTS, NODES);
+    printf("%-6s %5s %6s %6s %7s %7s %8s %8s %6s %8s %8s %10s\n",
+           "loss", "%", "copies", "bytes", "deliv%", "recov%", "delay_s", "max_s", "bad", "toa_dr0", "toa_dr5", "uplinks/s");
+    size_t mismatches = 0U;
+    for (const loss_model_t &m : models) {
+        std::mt19937 loss_rng(7U);
+        std::vector<bool> lost = make_losses(m, loss_rng);
+        for (size_t copies = 0; copies <= FEC_V1_MAX_COPIES; ++copies) {
+            run_result_t r = run(events, lost, copies);
+            mismatches += r.mismatches;
+            size_t phy_len = SIM_LORAWAN_OVERHEAD + (size_t)(r.bytes_avg + 0.5);
+            printf("%-6s %5.1f %6zu %6.1f %7.2f %7.2f %8.1f %8lu %6zu %8.3f %8.3f %10.0f\n",
+                   m.name, 100.0 * m.loss, copies, r.bytes_avg, r.delivered, r.recovered, r.delay_avg_s,
+                   (unsigned long)r.delay_max_s, r.mismatches,
+                   sim_airtime_s(sim_dr_to_sf(0U), phy_len), sim_airtime_s(sim_dr_to_sf(5U), phy_len),
+                   r.uplinks_per_s);
+        }
+    }
+    if (mismatches != 0U) {
+        printf("FAIL: %zu recovered events differ from the original\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+// Host benchmark: node_registry vs the former flat uint32_t[256] replay table.
+// Reports per-lookup time and memory for several fleet sizes, after checking
+// each run against a std::map with the same admission rule (nodes past
+// max_nodes are refused). Exits nonzero if the registry disagrees.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "node_registry.h"
+#include "node_slot.h"
+
+namespace {
+
+constexpr size_t LOOKUPS = 4000000U;
+constexpr size_t ID_SPACE = 256U;
+
+volatile uint32_t sink = 0U;
+
+std::vector<uint8_t> make_fleet(size_t fleet, std::mt19937 &rng)
+{
+    std::vector<uint8_t> all(ID_SPACE);
+    for (size_t i = 0; i < all.size(); ++i) {
+        all[i] = (uint8_t)i;
+    }
+    std::shuffle(all.begin(), all.end(), rng);
+    all.resize(fleet);
+    return all;
+}
+
+std::vector<uint8_t> make_trace(const std::vector<uint8_t> &fleet, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<size_t> pick(0U, fleet.size() - 1U);
+    std::vector<uint8_t> trace(LOOKUPS);
+    for (size_t i = 0; i < trace.size(); ++i) {
+        trace[i] = fleet[pick(rng)];
+    }
+    return trace;
+}
+
+double bench_flat(const std::vector<uint8_t> &trace)
+{
+    static uint32_t last_counter_by_node[ID_SPACE];
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < trace.size(); ++i) {
+        uint32_t &c = last_counter_by_node[trace[i]];
+        c++;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    sink += last_counter_by_node[trace[0]];
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / (double)trace.size();
+}
+
+// Replays the trace on a fresh registry and on the reference map, op by op:
+// same slot present or refused, then same per-node counts and rejections.
+template <size_t Capacity>
+bool check_registry(const std::vector<uint8_t> &trace)
+{
+    typedef node_registry<uint8_t, node_slot_t, Capacity> registry_t;
+    static registry_t reg;
+    reg.clear();
+    std::map<uint8_t, uint32_t> ref;
+    uint32_t ref_rejected = 0U;
+
+    for (size_t i = 0; i < trace.size(); ++i) {
+        uint8_t id = trace[i];
+        auto it = ref.find(id);
+        if (it == ref.end() && ref.size() < registry_t::max_nodes) {
+            it = ref.emplace(id, 0U).first;
+        }
+        bool inserted = false;
+        node_slot_t *slot = reg.find_or_insert(id, &inserted);
+        if (it == ref.end()) {
+            ref_rejected++;
+            if (slot != nullptr) {
+                printf("FAIL cap=%zu op=%zu id=%u: accepted past max_nodes\n", Capacity, i, (unsigned)id);
+                return false;
+            }
+            continue;
+        }
+        if (slot == nullptr || inserted != (it->second == 0U)) {
+            printf("FAIL cap=%zu op=%zu id=%u: slot=%p inserted=%d\n",
+                   Capacity, i, (unsigned)id, (void *)slot, inserted ? 1 : 0);
+            return false;
+        }
+        slot->rx_ok++;
+        it->second++;
+    }
+
+    size_t visited = 0U;
+    bool ok = reg.size() == ref.size() && reg.rejected() == ref_rejected;
+    reg.for_each([&](uint8_t id, node_slot_t &slot) {
+        auto it = ref.find(id);
+        ok = ok && it != ref.end() && it->second == slot.rx_ok;
+        visited++;
+    });
+    for (const auto &kv : ref) {
+        node_slot_t *slot = reg.find(kv.first);
+        ok = ok && slot != nullptr && slot->rx_ok == kv.second;
+    }
+    if (!ok || visited != ref.size()) {
+        printf("FAIL cap=%zu: size=%zu/%zu rejected=%lu/%lu visited=%zu\n",
+               Capacity, reg.size(), ref.size(),
+               (unsigned long)reg.rejected(), (unsigned long)ref_rejected, visited);
+        return false;
+    }
+    return true;
+}
+
+template <size_t Capacity>
+void bench_registry(size_t fleet, const std::vector<uint8_t> &trace, double flat_ns)
+{
+    static node_registry<uint8_t, node_slot_t, Capacity> reg;
+    reg.clear();
+    uint32_t refused = 0U;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < trace.size(); ++i) {
+        bool inserted = false;
+        node_slot_t *slot = reg.find_or_insert(trace[i], &inserted);
+        if (slot != nullptr) {
+            slot->rx_ok++;
+        } else {
+            refused++;
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / (double)trace.size();
+    sink += (uint32_t)reg.size() + refused;
+
+    printf("%6zu %9zu %6zu %8zu %10.2f %10.2f %10lu\n",
+           fleet, Capacity, reg.max_nodes, sizeof(reg), ns, flat_ns, (unsigned long)reg.rejected());
+}
+
+template <size_t Capacity>
+bool run(size_t fleet, std::mt19937 &rng)
+{
+    std::vector<uint8_t> ids = make_fleet(fleet, rng);
+    std::vector<uint8_t> trace = make_trace(ids, rng);
+    if (!check_registry<Capacity>(trace)) {
+        return false;
+    }
+    bench_registry<Capacity>(fleet, trace, bench_flat(trace));
+    return true;
+}
+
+}  // namespace
+
+int main()
+{
+    std::mt19937 rng(42U);
+
+    printf("node_slot_t: %zu bytes, flat uint32_t[256]: %zu bytes\n", sizeof(node_slot_t), sizeof(uint32_t) * ID_SPACE);
+    printf("%6s %9s %6s %8s %10s %10s %10s\n", "fleet", "capacity", "nodes", "bytes", "reg ns/op", "flat ns/op", "rejected");
+
+    bool ok = run<4>(2, rng)
+        && run<8>(3, rng)
+        && run<8>(6, rng)
+        && run<8>(12, rng)
+        && run<32>(16, rng)
+        && run<128>(64, rng)
+        && run<512>(256, rng);
+
+    if (!ok) {
+        return 1;
+    }
+    return (int)(sink & 0U);
+}
@@ -0,0 +1,103 @@
+// Host benchmark: UART v1 frame parser with tracepoints compiled in
+// (BRIDGE_TRACEPOINTS). Streams valid, corrupted and noise frames through
+// one parser per port, then prints the tracepoint table next to the overall
+// byte rate, so the tracepoint overhead can be compared with the work it
+// measures.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "uart_v1_parser.h"
+
+namespace {
+
+constexpr size_t PORTS = 3U;
+constexpr size_t FRAMES = 200000U;
+
+std::vector<uint8_t> make_stream(std::mt19937 &rng)
+{
+    std::vector<uint8_t> out;
+    out.reserve(FRAMES * (UART_V1_FRAME_LEN + 2U));
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<int> pct(0, 99);
+    vision_uart_payload_v1_t p = {};
+    p.ver = UART_V1_VERSION;
+    p.msg_type = UART_V1_MSG_HEARTBEAT;
+    for (size_t i = 0; i < FRAMES; ++i) {
+        p.counter = (uint32_t)i;
+        p.luma = (uint8_t)byte(rng);
+        uint8_t frame[UART_V1_FRAME_LEN];
+        size_t len = build_uart_frame_v1(&p, frame);
+        int roll = pct(rng);
+        if (roll < 2) {
+            frame[3U + (size_t)byte(rng) % UART_V1_PAYLOAD_LEN] ^= 0x40U;
+        } else if (roll < 4) {
+            out.push_back((uint8_t)byte(rng));
+            out.push_back((uint8_t)byte(rng));
+        }
+        out.insert(out.end(), frame, frame + len);
+    }
+    return out;
+}
+
+}  // namespace
+
+int main()
+{
+    std::mt19937 rng(1234U);
+    std::vector<uint8_t> streams[PORTS];
+    for (size_t k = 0; k < PORTS; ++k) {
+        streams[k] = make_stream(rng);
+    }
+
+    trace_init();
+    uart_v1_parser_t parsers[PORTS];
+    unsigned long frames = 0U;
+    unsigned long drops = 0U;
+    size_t bytes = 0U;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t pos = 0;; pos += UART_V1_FRAME_LEN) {
+        bool more = false;
+        for (size_t k = 0; k < PORTS; ++k) {
+            if (pos == 0U) {
+                uart_v1_parser_reset(&parsers[k]);
+            }
+            const std::vector<uint8_t> &s = streams[k];
+            size_t end = (pos + UART_V1_FRAME_LEN < s.size()) ? pos + UART_V1_FRAME_LEN : s.size();
+            for (size_t i = pos; i < end; ++i) {
+                TRACE_BEGIN(TRACE_UART_BYTE);
+                uart_v1_parse_result_t r = uart_v1_parser_feed(&parsers[k], s[i]);
+                TRACE_END(TRACE_UART_BYTE);
+                frames += (r == UART_V1_PARSE_FRAME) ? 1U : 0U;
+                drops += (r == UART_V1_PARSE_DROP_CRC || r == UART_V1_PARSE_DROP_LEN) ? 1U : 0U;
+            }
+            bytes += (end > pos) ? end - pos : 0U;
+            more |= end < s.size();
+        }
+        if (!more) {
+            break;
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    printf("ports=%zu bytes=%zu frames=%lu drops=%lu %.1f MB/s (tracepoints on)\n",
+           PORTS, bytes, frames, drops, (double)bytes / secs / 1e6);
+    printf("%-20s %9s %8s %8s %8s (%s)\n", "tracepoint", "count", "min", "avg", "max", TRACE_UNIT);
+    for (size_t i = 0; i < TRACE_ID_COUNT; ++i) {
+        const trace_stat_t &s = trace_stats()[i];
+        if (s.count == 0U) {
+            continue;
+        }
+        printf("%-20s %9lu %8lu %8lu %8lu\n",
+               trace_name((trace_id_t)i),
+               (unsigned long)s.count,
+               (unsigned long)s.min,
+               (unsigned long)trace_avg(&s),
+               (unsigned long)s.max);
+    }
+    return 0;
+}
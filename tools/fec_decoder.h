@@ -0,0 +1,171 @@
+#pragma once
+
+// Decoder for FPort 21 uplinks (raw event + copies of the previous events,
+// build_fec_uplink_v1() in protocol_lorawan_v1.h). Feed uplinks in receive
+// order; each call returns the events not seen before, recovered copies
+// first (oldest first), then the uplink's own event. Events are deduplicated
+// per node on the UART counter over the last FEC_DECODER_WINDOW counters.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol_lorawan_v1.h"
+
+#define FEC_DECODER_NODES         256U
+#define FEC_DECODER_WINDOW        64U
+#define FEC_DECODER_MAX_EVENTS    (FEC_V1_MAX_COPIES + 1U)
+
+typedef struct {
+    uint32_t rx_s;          // receive time of the uplink
+    uint32_t event_s;       // rx_s - age_s for a copy
+    uint32_t counter;       // copies: high bits taken from the node's latest counter
+    uint8_t node_id;
+    uint8_t msg_type;
+    uint8_t flags;
+    uint8_t luma;
+    uint8_t occupied;
+    uint8_t recovered;      // 1 = rebuilt from a copy
+} fec_event_t;
+
+typedef struct {
+    uint32_t last_counter;
+    uint64_t seen;          // bit i: last_counter - i was delivered
+    uint8_t valid;
+} fec_node_state_t;
+
+typedef struct {
+    fec_node_state_t nodes[FEC_DECODER_NODES];
+    unsigned long long uplinks;
+    unsigned long long events;
+    unsigned long long recovered;
+    unsigned long long duplicates;
+    unsigned long long stale;
+    unsigned long long bad;
+} fec_decoder_t;
+
+static inline void fec_decoder_reset(fec_decoder_t *d)
+{
+    for (size_t i = 0; i < FEC_DECODER_NODES; ++i) {
+        d->nodes[i].valid = 0U;
+    }
+    d->uplinks = 0U;
+    d->events = 0U;
+    d->recovered = 0U;
+    d->duplicates = 0U;
+    d->stale = 0U;
+    d->bad = 0U;
+}
+
+typedef enum {
+    FEC_SEEN_NEW = 0,
+    FEC_SEEN_DUPLICATE,
+    FEC_SEEN_STALE
+} fec_seen_t;
+
+// A primary counter far behind the window is an ESP reboot and restarts the
+// node; a copy that far from the window, either way, is dropped as stale.
+static inline fec_seen_t fec_decoder_mark(fec_node_state_t *n, uint32_t counter, bool primary)
+{
+    if (!n->valid) {
+        n->valid = 1U;
+        n->last_counter = counter;
+        n->seen = 1U;
+        return FEC_SEEN_NEW;
+    }
+    int32_t ahead = (int32_t)(counter - n->last_counter);
+    if (!primary && ahead >= (int32_t)FEC_DECODER_WINDOW) {
+        return FEC_SEEN_STALE;
+    }
+    if (ahead > 0) {
+        n->seen = ((uint32_t)ahead >= FEC_DECODER_WINDOW) ? 0U : (n->seen << ahead);
+        n->seen |= 1U;
+        n->last_counter = counter;
+        return FEC_SEEN_NEW;
+    }
+    uint32_t back = (uint32_t)-ahead;
+    if (back >= FEC_DECODER_WINDOW) {
+        if (!primary) {
+            return FEC_SEEN_STALE;
+        }
+        n->last_counter = counter;
+        n->seen = 1U;
+        return FEC_SEEN_NEW;
+    }
+    uint64_t bit = (uint64_t)1U << back;
+    if ((n->seen & bit) != 0U) {
+        return FEC_SEEN_DUPLICATE;
+    }
+    n->seen |= bit;
+    return FEC_SEEN_NEW;
+}
+
+// out must hold FEC_DECODER_MAX_EVENTS. Returns the number of new events;
+// malformed uplinks return 0 and are counted in d->bad.
+static inline size_t fec_decoder_feed(fec_decoder_t *d, const uint8_t *buf, size_t len, uint32_t rx_s,
+                                      fec_event_t *out)
+{
+    if (len < FEC_V1_HEADER_LEN || buf[0] != LORA_V1_VERSION
+            || (len - FEC_V1_HEADER_LEN) % FEC_V1_COPY_LEN != 0U
+            || (len - FEC_V1_HEADER_LEN) / FEC_V1_COPY_LEN > FEC_V1_MAX_COPIES) {
+        d->bad++;
+        return 0U;
+    }
+    d->uplinks++;
+
+    vision_uart_payload_v1_t ev;
+    deserialize_payload_v1(&ev, &buf[1]);
+    fec_seen_t primary = fec_decoder_mark(&d->nodes[ev.node_id], ev.counter, true);
+
+    size_t n = 0U;
+    size_t copies = (len - FEC_V1_HEADER_LEN) / FEC_V1_COPY_LEN;
+    for (size_t i = copies; i-- > 0U;) {
+        fec_copy_v1_t c;
+        parse_fec_copy_v1(&buf[FEC_V1_HEADER_LEN + i * FEC_V1_COPY_LEN], &c);
+        fec_node_state_t *node = &d->nodes[c.node_id];
+        if (!node->valid) {
+            // No counter to take the high bits from yet.
+            d->stale++;
+            continue;
+        }
+        int16_t delta = (int16_t)(uint16_t)(c.counter_lo - (uint16_t)node->last_counter);
+        uint32_t counter = node->last_counter + (uint32_t)(int32_t)delta;
+        fec_seen_t seen = fec_decoder_mark(node, counter, false);
+        if (seen == FEC_SEEN_DUPLICATE) {
+            d->duplicates++;
+            continue;
+        }
+        if (seen == FEC_SEEN_STALE) {
+            d->stale++;
+            continue;
+        }
+        fec_event_t *e = &out[n++];
+        e->rx_s = rx_s;
+        e->event_s = rx_s - c.age_s;
+        e->counter = counter;
+        e->node_id = c.node_id;
+        e->msg_type = c.msg_type;
+        e->flags = c.flags;
+        e->luma = c.luma;
+        e->occupied = c.occupied;
+        e->recovered = 1U;
+        d->recovered++;
+    }
+
+    if (primary == FEC_SEEN_NEW) {
+        fec_event_t *e = &out[n++];
+        e->rx_s = rx_s;
+        e->event_s = rx_s;
+        e->counter = ev.counter;
+        e->node_id = ev.node_id;
+        e->msg_type = ev.msg_type;
+        e->flags = ev.flags;
+        e->luma = ev.luma;
+        e->occupied = ev.occupied;
+        e->recovered = 0U;
+    } else {
+        d->duplicates++;
+    }
+    d->events += n;
+    return n;
+}
@@ -0,0 +1,758 @@
+// Discrete-event simulator: N bridges, each with several cameras, sharing one
+// EU868 gateway (fleet_sim.h). Each bridge follows the firmware's forwarding
+// path: raw events, time batches or window summaries, one uplink in the
+// LoRaWAN stack at a time (a send while busy fails and the event is lost, as
+// in lorawan_send()), duty-cycle backoff per band, and the data rate from
+// fixed, network ADR or the datarate_policy.h link policy. Payload sizes come
+// from the same protocol builders as main.cpp. MAC answers (LinkCheckAns,
+// LinkADRReq, the answer to ADRACKReq) are downlinks from the same gateway:
+// they take its airtime and duty cycle, deafen it while on air, and are
+// dropped past the per-device fair-use cap; an answer that is not sent is
+// not seen by the bridge.
+//
+//   fleet_sim [--bridges 10,50,100] [--nodes 2] [--rate 12] [--hb 0]
+//             [--mode raw|batch|summary] [--batch-age 60] [--window 900]
+//             [--dr link|adr|fixed] [--dr-min 0] [--dr-max 5]
+//             [--radius 3] [--hours 24] [--rx-delay 5] [--dl-per-day 10]
+//             [--seed 1]
+//
+// --rate is occupancy events per camera per hour (Poisson), --hb an optional
+// heartbeat period per camera (s), --dl-per-day the downlinks per device per
+// day (TTN fair use, 0 = no cap). One output row per fleet size.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "datarate_policy.h"
+#include "fleet_sim.h"
+#include "protocol_lorawan_v1.h"
+
+namespace {
+
+constexpr double SUMMARY_RETRY_S = 30.0;   // SUMMARY_RETRY_PERIOD in main.cpp
+constexpr double RX_WINDOW_S = 1.2;        // RX2 opens 1 s after RX1 and times out
+constexpr double SHADOWING_DB = 6.0;
+constexpr double FADING_DB = 2.0;
+constexpr size_t ADR_HISTORY = 20U;
+constexpr double ADR_MARGIN_DB = 10.0;
+constexpr uint32_t ADR_ACK_LIMIT = 64U;
+constexpr uint32_t ADR_ACK_DELAY = 32U;
+constexpr size_t LINK_CHECK_ANS_LEN = 3U;  // CID | Margin | GwCnt
+constexpr size_t LINK_ADR_REQ_LEN = 5U;    // CID | DR_TXPower | ChMask | Redundancy
+
+enum forward_mode_t {
+    MODE_RAW = 0,
+    MODE_BATCH,
+    MODE_SUMMARY
+};
+
+struct options_t {
+    std::vector<size_t> bridges = {10U, 50U, 100U, 200U, 400U};
+    size_t nodes = 2U;
+    double rate_per_hour = 12.0;
+    double hb_s = 0.0;
+    forward_mode_t mode = MODE_RAW;
+    double batch_age_s = 60.0;
+    double window_s = 900.0;
+    uint8_t dr_mode = DR_V1_MODE_ADR;
+    uint8_t dr_min = 0U;
+    uint8_t dr_max = DL_V1_DR_MAX;
+    double radius_km = 3.0;
+    double hours = 24.0;
+    double rx_delay_s = 5.0;
+    uint32_t dl_per_day = 10U;
+    unsigned seed = 1U;
+};
+
+enum event_type_t {
+    EV_CAMERA = 0,
+    EV_HEARTBEAT,
+    EV_BATCH_AGE,
+    EV_WINDOW,
+    EV_SUMMARY_RETRY,
+    EV_TX_START,
+    EV_TX_END,
+    EV_DOWNLINK,
+    EV_TX_DONE
+};
+
+struct event_t {
+    double t;
+    event_type_t type;
+    uint32_t bridge;
+    uint32_t arg;
+
+    bool operator>(const event_t &o) const
+    {
+        return t > o.t;
+    }
+};
+
+struct bridge_t {
+    double rssi_mean_dbm;
+    uint8_t dr;
+    dr_policy_t policy;
+    double band_free[2];
+    bool busy;
+
+    // Uplink in the stack; event times travel with it for latency.
+    std::vector<double> tx_events;
+    double tx_start;
+    double tx_end;
+    int tx_channel;
+    bool tx_probe;
+    bool tx_delivered;
+    double tx_snr;
+
+    std::vector<double> batch_events;
+    uint8_t batch_buf[BATCH_V1_MAX_LEN];
+    size_t batch_len;
+    uint32_t batch_gen;
+
+    std::vector<uint8_t> node_seen;
+    std::vector<std::vector<double>> window_events;
+    std::vector<std::vector<double>> summary_records;
+    size_t summary_sent;
+    bool summary_retry;
+
+    double adr_snr[ADR_HISTORY];
+    size_t adr_count;
+    uint32_t adr_ack_cnt;
+    uint8_t adr_next_dr;    // LinkADRReq the network wants to send
+
+    bool dl_received;       // answer to the uplink in the stack
+    uint32_t dl_day;
+    uint32_t dl_today;
+
+    double airtime_s;
+};
+
+struct results_t {
+    unsigned long long events;
+    unsigned long long delivered;
+    unsigned long long drop_busy;
+    unsigned long long drop_window;
+    unsigned long long lost_weak;
+    unsigned long long lost_collision;
+    unsigned long long lost_no_path;
+    unsigned long long lost_gw_tx;
+    unsigned long long uplinks;
+    unsigned long long dl_wanted;
+    unsigned long long dl_sent;
+    unsigned long long dl_fair_use;
+    unsigned long long dl_gateway;
+    unsigned long long dr_changes;
+    std::vector<float> latency_s;
+};
+
+class simulation {
+public:
+    simulation(const options_t &opt, size_t n_bridges)
+        : opt_(opt), rng_(opt.seed * 7919U + (unsigned)n_bridges), bridges_(n_bridges), gw_(), res_()
+    {
+        end_s_ = opt.hours * 3600.0;
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::normal_distribution<double> shadow(0.0, SHADOWING_DB);
+        for (size_t i = 0; i < bridges_.size(); ++i) {
+            bridge_t &b = bridges_[i];
+            // Uniform over the disc around the gateway.
+            double dist = opt.radius_km * std::sqrt(unit(rng_));
+            b.rssi_mean_dbm = SIM_TX_POWER_DBM - sim_path_loss_db(dist) + shadow(rng_);
+            b.dr = (opt.dr_mode == DR_V1_MODE_FIXED) ? opt.dr_max : opt.dr_min;
+            dr_policy_reset(&b.policy, opt.dr_min, 0U);
+            b.band_free[0] = b.band_free[1] = 0.0;
+            b.busy = false;
+            b.batch_len = 0U;
+            b.batch_gen = 0U;
+            b.node_seen.assign(opt.nodes, 0U);
+            b.window_events.assign(opt.nodes, std::vector<double>());
+            b.summary_sent = 0U;
+            b.summary_retry = false;
+            b.adr_count = 0U;
+            b.adr_ack_cnt = 0U;
+            b.adr_next_dr = b.dr;
+            b.dl_received = false;
+            b.dl_day = 0U;
+            b.dl_today = 0U;
+            b.airtime_s = 0.0;
+
+            for (size_t n = 0; n < opt.nodes; ++n) {
+                if (opt.rate_per_hour > 0.0) {
+                    push(next_camera_event(0.0), EV_CAMERA, i, (uint32_t)n);
+                }
+                if (opt.hb_s > 0.0) {
+                    push(unit(rng_) * opt.hb_s, EV_HEARTBEAT, i, (uint32_t)n);
+                }
+            }
+            if (opt.mode == MODE_SUMMARY) {
+                push(unit(rng_) * opt.window_s, EV_WINDOW, i, 0U);
+            }
+        }
+    }
+
+    const results_t &run()
+    {
+        // After the last event, windows and retries get one more window to drain.
+        double stop = end_s_ + opt_.window_s + 600.0;
+        while (!queue_.empty()) {
+            event_t ev = queue_.top();
+            queue_.pop();
+            if (ev.t > stop) {
+                break;
+            }
+            now_ = ev.t;
+            dispatch(ev);
+        }
+        elapsed_s_ = std::max(end_s_, now_);
+        for (const bridge_t &b : bridges_) {
+            dr_final_ += current_dr(b);
+        }
+        return res_;
+    }
+
+    double mean_dr() const
+    {
+        return bridges_.empty() ? 0.0 : dr_final_ / (double)bridges_.size();
+    }
+
+    double max_bridge_duty() const
+    {
+        double max_air = 0.0;
+        for (const bridge_t &b : bridges_) {
+            max_air = std::max(max_air, b.airtime_s);
+        }
+        return max_air / elapsed_s_;
+    }
+
+    double elapsed_hours() const
+    {
+        return elapsed_s_ / 3600.0;
+    }
+
+    double total_airtime_s() const
+    {
+        double sum = 0.0;
+        for (const bridge_t &b : bridges_) {
+            sum += b.airtime_s;
+        }
+        return sum;
+    }
+
+    double channel_load() const
+    {
+        double max_load = 0.0;
+        for (size_t c = 0; c < SIM_CHANNELS; ++c) {
+            max_load = std::max(max_load, gw_.airtime_s[c] / elapsed_s_);
+        }
+        return max_load;
+    }
+
+    double gateway_tx_share() const
+    {
+        return gw_.tx_airtime_s / elapsed_s_;
+    }
+
+private:
+    void push(double t, event_type_t type, size_t bridge, uint32_t arg)
+    {
+        queue_.push(event_t{t, type, (uint32_t)bridge, arg});
+    }
+
+    double next_camera_event(double t)
+    {
+        std::exponential_distribution<double> gap(opt_.rate_per_hour / 3600.0);
+        return t + gap(rng_);
+    }
+
+    void dispatch(const event_t &ev)
+    {
+        bridge_t &b = bridges_[ev.bridge];
+        switch (ev.type) {
+            case EV_CAMERA:
+                on_frame(b, ev.bridge, ev.arg);
+                {
+                    double next = next_camera_event(now_);
+                    if (next < end_s_) {
+                        push(next, EV_CAMERA, ev.bridge, ev.arg);
+                    }
+                }
+                break;
+            case EV_HEARTBEAT:
+                on_frame(b, ev.bridge, ev.arg);
+                if (now_ + opt_.hb_s < end_s_) {
+                    push(now_ + opt_.hb_s, EV_HEARTBEAT, ev.bridge, ev.arg);
+                }
+                break;
+            case EV_BATCH_AGE:
+                if (ev.arg == b.batch_gen) {
+                    batch_flush(b, ev.bridge);
+                }
+                break;
+            case EV_WINDOW:
+                window_tick(b, ev.bridge);
+                if (now_ < end_s_) {
+                    push(now_ + opt_.window_s, EV_WINDOW, ev.bridge, 0U);
+                }
+                break;
+            case EV_SUMMARY_RETRY:
+                b.summary_retry = false;
+                send_summary_chunk(b, ev.bridge);
+                break;
+            case EV_TX_START:
+                tx_start(b, ev.bridge);
+                break;
+            case EV_TX_END:
+                tx_end(b, ev.bridge);
+                break;
+            case EV_DOWNLINK:
+                downlink(b);
+                break;
+            case EV_TX_DONE:
+                tx_done(b, ev.bridge);
+                break;
+        }
+    }
+
+    // on_payload_valid(): every frame is one event to deliver.
+    void on_frame(bridge_t &b, size_t index, uint32_t node)
+    {
+        res_.events++;
+        b.node_seen[node] = 1U;
+        if (opt_.mode == MODE_SUMMARY) {
+            b.window_events[node].push_back(now_);
+        } else if (opt_.mode == MODE_BATCH) {
+            batch_add(b, index, node);
+        } else {
+            std::vector<double> events(1U, now_);
+            if (!lorawan_send(b, index, UART_V1_PAYLOAD_LEN, events)) {
+                res_.drop_busy++;
+            }
+        }
+    }
+
+    void batch_add(bridge_t &b, size_t index, uint32_t node)
+    {
+        if (b.batch_events.empty()) {
+            b.batch_len = batch_v1_begin(b.batch_buf, (uint32_t)now_);
+            push(now_ + opt_.batch_age_s, EV_BATCH_AGE, index, ++b.batch_gen);
+        }
+        vision_uart_payload_v1_t frame = {};
+        frame.ver = UART_V1_VERSION;
+        frame.node_id = (uint8_t)node;
+        frame.counter = (uint32_t)res_.events;
+        b.batch_len = batch_v1_append(b.batch_buf, b.batch_len, &frame, 0U);
+        b.batch_events.push_back(now_);
+        if (b.batch_events.size() >= BATCH_V1_MAX_EVENTS) {
+            batch_flush(b, index);
+        }
+    }
+
+    void batch_flush(bridge_t &b, size_t index)
+    {
+        b.batch_gen++;
+        if (b.batch_events.empty()) {
+            return;
+        }
+        if (!lorawan_send(b, index, b.batch_len, b.batch_events)) {
+            res_.drop_busy += b.batch_events.size();
+        }
+        b.batch_events.clear();
+    }
+
+    void window_tick(bridge_t &b, size_t index)
+    {
+        for (size_t i = b.summary_sent; i < b.summary_records.size(); ++i) {
+            res_.drop_window += b.summary_records[i].size();
+        }
+        b.summary_records.clear();
+        b.summary_sent = 0U;
+        for (size_t n = 0; n < opt_.nodes; ++n) {
+            if (b.node_seen[n]) {
+                b.summary_records.push_back(b.window_events[n]);
+                b.window_events[n].clear();
+            }
+        }
+        send_summary_chunk(b, index);
+    }
+
+    void send_summary_chunk(bridge_t &b, size_t index)
+    {
+        if (b.summary_sent >= b.summary_records.size()) {
+            return;
+        }
+        size_t n = std::min(b.summary_records.size() - b.summary_sent, (size_t)SUMMARY_V1_MAX_RECORDS);
+        summary_record_v1_t records[SUMMARY_V1_MAX_RECORDS] = {};
+        uint8_t buf[SUMMARY_V1_HEADER_LEN + SUMMARY_V1_RECORD_LEN * SUMMARY_V1_MAX_RECORDS];
+        size_t len = build_summary_uplink_v1(0U, (uint16_t)opt_.window_s, records, n, buf);
+
+        std::vector<double> events;
+        for (size_t i = b.summary_sent; i < b.summary_sent + n; ++i) {
+            events.insert(events.end(), b.summary_records[i].begin(), b.summary_records[i].end());
+        }
+        if (lorawan_send(b, index, len, events)) {
+            b.summary_sent += n;
+        } else if (!b.summary_retry) {
+            b.summary_retry = true;
+            push(now_ + SUMMARY_RETRY_S, EV_SUMMARY_RETRY, index, 0U);
+        }
+    }
+
+    uint8_t current_dr(const bridge_t &b) const
+    {
+        return (opt_.dr_mode == DR_V1_MODE_LINK) ? b.policy.dr : b.dr;
+    }
+
+    // lorawan_send(): fails while the stack holds an uplink; otherwise the
+    // frame goes out on a random channel of a band that is free, or waits for
+    // the first band to come out of its duty-cycle off time.
+    bool lorawan_send(bridge_t &b, size_t index, size_t len, const std::vector<double> &events)
+    {
+        if (b.busy) {
+            return false;
+        }
+        bool probe = opt_.dr_mode == DR_V1_MODE_LINK && dr_policy_want_probe(&b.policy, (uint32_t)now_);
+        int sf = sim_dr_to_sf(current_dr(b));
+        size_t phy_len = SIM_LORAWAN_OVERHEAD + len + (probe ? 1U : 0U);
+
+        std::uniform_int_distribution<int> pick(0, SIM_CHANNELS - 1);
+        int channel = pick(rng_);
+        for (int tries = 0; tries < SIM_CHANNELS && b.band_free[sim_channel_band(channel)] > now_; ++tries) {
+            channel = (channel + 1) % SIM_CHANNELS;
+        }
+        int band = sim_channel_band(channel);
+        if (b.band_free[band] > now_) {
+            band = (b.band_free[0] <= b.band_free[1]) ? 0 : 1;
+            channel = (band == 0) ? pick(rng_) % 5 : 5 + pick(rng_) % 3;
+        }
+        double airtime = sim_airtime_s(sf, phy_len);
+
+        b.busy = true;
+        b.tx_events = events;
+        b.tx_start = std::max(now_, b.band_free[band]);
+        b.tx_end = b.tx_start + airtime;
+        b.tx_channel = channel;
+        b.tx_probe = probe;
+        b.band_free[band] = b.tx_start + airtime * SIM_DUTY_CYCLE;
+        b.airtime_s += airtime;
+        dr_policy_on_send(&b.policy, probe, (uint32_t)now_);
+        res_.uplinks++;
+        push(b.tx_start, EV_TX_START, index, 0U);
+        return true;
+    }
+
+    void tx_start(bridge_t &b, size_t index)
+    {
+        std::normal_distribution<double> fading(0.0, FADING_DB);
+        sim_rx_t rx = {};
+        rx.start = b.tx_start;
+        rx.end = b.tx_end;
+        rx.rssi_dbm = b.rssi_mean_dbm + fading(rng_);
+        rx.channel = b.tx_channel;
+        rx.sf = sim_dr_to_sf(current_dr(b));
+        rx.id = index;
+        b.tx_snr = rx.rssi_dbm - SIM_NOISE_FLOOR_DBM;
+        sim_gateway_begin(&gw_, rx);
+        push(b.tx_end, EV_TX_END, index, 0U);
+    }
+
+    void tx_end(bridge_t &b, size_t index)
+    {
+        sim_rx_result_t r = sim_gateway_end(&gw_, index);
+        b.tx_delivered = r == SIM_RX_OK;
+        size_t n = b.tx_events.size();
+        switch (r) {
+            case SIM_RX_OK:
+                res_.delivered += n;
+                for (double t : b.tx_events) {
+                    res_.latency_s.push_back((float)(now_ - t));
+                }
+                break;
+            case SIM_RX_WEAK:      res_.lost_weak += n; break;
+            case SIM_RX_COLLISION: res_.lost_collision += n; break;
+            case SIM_RX_NO_PATH:   res_.lost_no_path += n; break;
+            case SIM_RX_GW_TX:     res_.lost_gw_tx += n; break;
+        }
+
+        b.dl_received = false;
+        if (b.tx_delivered && network_wants_downlink(b)) {
+            res_.dl_wanted++;
+            push(now_ + opt_.rx_delay_s, EV_DOWNLINK, index, 0U);
+        }
+        push(now_ + opt_.rx_delay_s + RX_WINDOW_S, EV_TX_DONE, index, 0U);
+    }
+
+    // Network server, on a received uplink: a LinkCheckReq needs its answer;
+    // ADR wants a downlink to raise the DR or to answer ADRACKReq.
+    bool network_wants_downlink(bridge_t &b)
+    {
+        if (opt_.dr_mode == DR_V1_MODE_LINK) {
+            return b.tx_probe;
+        }
+        if (opt_.dr_mode == DR_V1_MODE_ADR) {
+            return network_adr(b, sim_dr_to_sf(b.dr));
+        }
+        return false;
+    }
+
+    // The answer goes out in RX1 (uplink channel and DR) or else RX2, if the
+    // bridge is within its downlinks for the day and the gateway can send.
+    // The bridge is assumed to receive every downlink sent.
+    void downlink(bridge_t &b)
+    {
+        uint32_t day = (uint32_t)(now_ / 86400.0);
+        if (day != b.dl_day) {
+            b.dl_day = day;
+            b.dl_today = 0U;
+        }
+        if (opt_.dl_per_day != 0U && b.dl_today >= opt_.dl_per_day) {
+            res_.dl_fair_use++;
+            return;
+        }
+        size_t len = SIM_DL_OVERHEAD;
+        if (opt_.dr_mode == DR_V1_MODE_LINK) {
+            len += LINK_CHECK_ANS_LEN;
+        } else if (b.adr_next_dr != b.dr) {
+            len += LINK_ADR_REQ_LEN;
+        }
+        double rx1_air = sim_airtime_s(sim_dr_to_sf(current_dr(b)), len);
+        double rx2_air = sim_airtime_s(sim_dr_to_sf(SIM_RX2_DR), len);
+        if (!sim_gateway_downlink(&gw_, sim_channel_band(b.tx_channel), now_, rx1_air, SIM_DUTY_CYCLE)
+                && !sim_gateway_downlink(&gw_, SIM_BAND_RX2, now_ + SIM_RX2_DELAY_S, rx2_air, SIM_RX2_DUTY_CYCLE)) {
+            res_.dl_gateway++;
+            return;
+        }
+        b.dl_today++;
+        b.dl_received = true;
+        res_.dl_sent++;
+    }
+
+    // TX_DONE after the receive windows: the answer, if one was sent, is
+    // handled, then the stack takes the next uplink. One gateway, so
+    // LinkCheckAns always reports one.
+    void tx_done(bridge_t &b, size_t index)
+    {
+        b.busy = false;
+        uint8_t dr_before = current_dr(b);
+        int sf = sim_dr_to_sf(dr_before);
+        if (opt_.dr_mode == DR_V1_MODE_LINK) {
+            if (b.dl_received) {
+                double margin = b.tx_snr - sim_snr_floor_db(sf);
+                uint8_t margin_db = (uint8_t)std::min(254.0, std::max(0.0, margin));
+                dr_policy_on_link_check(&b.policy, margin_db, 1U, opt_.dr_min, opt_.dr_max);
+            }
+            dr_policy_on_tx_done(&b.policy, true, opt_.dr_min, opt_.dr_max);
+        } else if (opt_.dr_mode == DR_V1_MODE_ADR) {
+            device_adr(b);
+        }
+        if (current_dr(b) != dr_before) {
+            res_.dr_changes++;
+        }
+        if (b.summary_sent < b.summary_records.size()) {
+            send_summary_chunk(b, index);
+        }
+    }
+
+    // Network side, per received uplink: raises the DR from the best SNR of
+    // the last 20 uplinks with a 10 dB margin, and answers ADRACKReq, which
+    // the device sets from ADR_ACK_LIMIT uplinks without a downlink.
+    // Returns true if either needs a downlink.
+    bool network_adr(bridge_t &b, int sf)
+    {
+        b.adr_snr[b.adr_count % ADR_HISTORY] = b.tx_snr;
+        b.adr_count++;
+        b.adr_next_dr = b.dr;
+        if (b.adr_count >= ADR_HISTORY) {
+            double best = *std::max_element(b.adr_snr, b.adr_snr + ADR_HISTORY);
+            int steps = (int)((best - sim_snr_floor_db(sf) - ADR_MARGIN_DB) / 2.5);
+            if (steps > 0 && b.dr < DL_V1_DR_MAX) {
+                b.adr_next_dr = (uint8_t)std::min<int>(DL_V1_DR_MAX, b.dr + steps);
+            }
+        }
+        return b.adr_next_dr != b.dr || b.adr_ack_cnt >= ADR_ACK_LIMIT;
+    }
+
+    // Device side at TX_DONE: a downlink resets ADR_ACK_CNT and carries the
+    // LinkADRReq, if any; with none for ADR_ACK_LIMIT + ADR_ACK_DELAY uplinks
+    // the device backs off one DR. Then clamped to dr_min..dr_max as
+    // clamp_adr_datarate() does.
+    void device_adr(bridge_t &b)
+    {
+        b.adr_ack_cnt++;
+        if (b.dl_received) {
+            b.adr_ack_cnt = 0U;
+            if (b.adr_next_dr != b.dr) {
+                b.dr = b.adr_next_dr;
+                b.adr_count = 0U;
+            }
+        }
+        if (b.adr_ack_cnt >= ADR_ACK_LIMIT + ADR_ACK_DELAY) {
+            b.adr_ack_cnt = ADR_ACK_LIMIT;
+            if (b.dr > 0U) {
+                b.dr--;
+            }
+        }
+        b.dr = std::min(std::max(b.dr, opt_.dr_min), opt_.dr_max);
+    }
+
+    options_t opt_;
+    std::mt19937 rng_;
+    std::vector<bridge_t> bridges_;
+    sim_gateway_t gw_;
+    results_t res_;
+    std::priority_queue<event_t, std::vector<event_t>, std::greater<event_t>> queue_;
+    double now_ = 0.0;
+    double end_s_ = 0.0;
+    double elapsed_s_ = 0.0;
+    double dr_final_ = 0.0;
+};
+
+double percentile(std::vector<float> &v, double p)
+{
+    if (v.empty()) {
+        return 0.0;
+    }
+    size_t k = (size_t)(p * (double)(v.size() - 1U));
+    std::nth_element(v.begin(), v.begin() + (long)k, v.end());
+    return v[k];
+}
+
+double pct(unsigned long long part, unsigned long long whole)
+{
+    return (whole != 0U) ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+int usage()
+{
+    fprintf(stderr,
+            "usage: fleet_sim [--bridges 10,50,100] [--nodes 2] [--rate 12] [--hb 0]\n"
+            "                 [--mode raw|batch|summary] [--batch-age 60] [--window 900]\n"
+            "                 [--dr link|adr|fixed] [--dr-min 0] [--dr-max 5]\n"
+            "                 [--radius 3] [--hours 24] [--rx-delay 5] [--dl-per-day 10]\n"
+            "                 [--seed 1]\n");
+    return 2;
+}
+
+bool parse_args(int argc, char **argv, options_t *opt)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char *key = argv[i];
+        const char *v = argv[++i];
+        if (strcmp(key, "--bridges") == 0) {
+            opt->bridges.clear();
+            for (const char *p = v; *p != '\0';) {
+                char *end = nullptr;
+                unsigned long n = strtoul(p, &end, 10);
+                if (end == p || n == 0U) {
+                    return false;
+                }
+                opt->bridges.push_back((size_t)n);
+                p = (*end == ',') ? end + 1 : end;
+            }
+        } else if (strcmp(key, "--nodes") == 0) {
+            opt->nodes = (size_t)strtoul(v, nullptr, 10);
+        } else if (strcmp(key, "--rate") == 0) {
+            opt->rate_per_hour = atof(v);
+        } else if (strcmp(key, "--hb") == 0) {
+            opt->hb_s = atof(v);
+        } else if (strcmp(key, "--mode") == 0) {
+            if (strcmp(v, "raw") == 0) {
+                opt->mode = MODE_RAW;
+            } else if (strcmp(v, "batch") == 0) {
+                opt->mode = MODE_BATCH;
+            } else if (strcmp(v, "summary") == 0) {
+                opt->mode = MODE_SUMMARY;
+            } else {
+                return false;
+            }
+        } else if (strcmp(key, "--batch-age") == 0) {
+            opt->batch_age_s = atof(v);
+        } else if (strcmp(key, "--window") == 0) {
+            opt->window_s = atof(v);
+        } else if (strcmp(key, "--dr") == 0) {
+            if (strcmp(v, "link") == 0) {
+                opt->dr_mode = DR_V1_MODE_LINK;
+            } else if (strcmp(v, "adr") == 0) {
+                opt->dr_mode = DR_V1_MODE_ADR;
+            } else if (strcmp(v, "fixed") == 0) {
+                opt->dr_mode = DR_V1_MODE_FIXED;
+            } else {
+                return false;
+            }
+        } else if (strcmp(key, "--dr-min") == 0) {
+            opt->dr_min = (uint8_t)atoi(v);
+        } else if (strcmp(key, "--dr-max") == 0) {
+            opt->dr_max = (uint8_t)atoi(v);
+        } else if (strcmp(key, "--radius") == 0) {
+            opt->radius_km = atof(v);
+        } else if (strcmp(key, "--hours") == 0) {
+            opt->hours = atof(v);
+        } else if (strcmp(key, "--rx-delay") == 0) {
+            opt->rx_delay_s = atof(v);
+        } else if (strcmp(key, "--dl-per-day") == 0) {
+            opt->dl_per_day = (uint32_t)strtoul(v, nullptr, 10);
+        } else if (strcmp(key, "--seed") == 0) {
+            opt->seed = (unsigned)strtoul(v, nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return opt->nodes != 0U && opt->hours > 0.0 && opt->window_s > 0.0
+        && opt->dr_min <= opt->dr_max && opt->dr_max <= DL_V1_DR_MAX;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    options_t opt;
+    if (!parse_args(argc, argv, &opt)) {
+        return usage();
+    }
+
+    static const char *const mode_names[] = {"raw", "batch", "summary"};
+    static const char *const dr_names[] = {"fixed", "adr", "link"};
+    printf("mode=%s dr=%s(%u..%u) nodes/bridge=%zu rate=%.1f/h hb=%.0fs radius=%.1fkm hours=%.1f dl/day=%lu\n",
+           mode_names[opt.mode], dr_names[opt.dr_mode], (unsigned)opt.dr_min, (unsigned)opt.dr_max,
+           opt.nodes, opt.rate_per_hour, opt.hb_s, opt.radius_km, opt.hours, (unsigned long)opt.dl_per_day);
+    printf("%7s %9s %7s %6s %6s %6s %6s %6s %6s %7s %7s %7s %8s %6s %6s %5s %6s %6s %6s %6s\n",
+           "bridges", "events", "deliv%", "busy%", "coll%", "weak%", "path%", "hdx%", "win%",
+           "p50_s", "p90_s", "p99_s", "air_s/h", "air%", "chan%", "dr", "dl/d", "fair%", "gwdc%", "gwtx%");
+
+    for (size_t n : opt.bridges) {
+        simulation sim(opt, n);
+        results_t res = sim.run();
+        printf("%7zu %9llu %7.2f %6.2f %6.2f %6.2f %6.2f %6.2f %6.2f %7.1f %7.1f %7.1f %8.1f %6.3f %6.2f %5.2f"
+               " %6.2f %6.1f %6.1f %6.2f\n",
+               n,
+               res.events,
+               pct(res.delivered, res.events),
+               pct(res.drop_busy, res.events),
+               pct(res.lost_collision, res.events),
+               pct(res.lost_weak, res.events),
+               pct(res.lost_no_path, res.events),
+               pct(res.lost_gw_tx, res.events),
+               pct(res.drop_window, res.events),
+               percentile(res.latency_s, 0.50),
+               percentile(res.latency_s, 0.90),
+               percentile(res.latency_s, 0.99),
+               sim.total_airtime_s() / (double)n / sim.elapsed_hours(),
+               100.0 * sim.max_bridge_duty(),
+               100.0 * sim.channel_load(),
+               sim.mean_dr(),
+               (double)res.dl_sent / (double)n / (sim.elapsed_hours() / 24.0),
+               pct(res.dl_fair_use, res.dl_wanted),
+               pct(res.dl_gateway, res.dl_wanted),
+               100.0 * sim.gateway_tx_share());
+        fflush(stdout);
+    }
+    return 0;
+}
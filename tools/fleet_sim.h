@@ -0,0 +1,194 @@
+#pragma once
+
+// EU868 channel and gateway model for the fleet simulator (fleet_sim.cpp):
+// LoRa time on air, path loss, duty-cycle bands and reception at a single
+// gateway with same-SF capture and imperfect SF orthogonality. The gateway is
+// half-duplex: while it sends a downlink it hears no uplink.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#define SIM_BW_HZ                 125000.0
+#define SIM_PREAMBLE_SYMBOLS      8
+#define SIM_LORAWAN_OVERHEAD      13   // MHDR | DevAddr | FCtrl | FCnt | FPort | MIC
+#define SIM_TX_POWER_DBM          14.0
+#define SIM_NOISE_FLOOR_DBM       (-117.0) // kTB at 125 kHz + 6 dB noise figure
+#define SIM_CAPTURE_DB            6.0  // same SF: the stronger frame survives by this much
+#define SIM_SF_REJECTION_DB       16.0 // other SF: destroys the frame only above this
+#define SIM_GATEWAY_PATHS         8    // SX1301 demodulators
+#define SIM_CHANNELS              8
+#define SIM_DUTY_CYCLE            100  // 1 %: band free again after airtime * 100
+#define SIM_DL_OVERHEAD           12   // MHDR | DevAddr | FCtrl | FCnt | MIC, MAC answers in FOpts
+#define SIM_RX2_DELAY_S           1.0  // RX2 opens 1 s after RX1
+#define SIM_RX2_DR                3    // TTN EU868 RX2: 869.525 MHz, SF9
+#define SIM_RX2_DUTY_CYCLE        10   // band P, 10 %
+#define SIM_BAND_RX2              2    // gateway bands: G and G1 for RX1, P for RX2
+#define SIM_GATEWAY_BANDS         3
+
+// EU868 DR0..DR5 = SF12..SF7 at 125 kHz.
+static inline int sim_dr_to_sf(uint8_t dr)
+{
+    return 12 - (int)dr;
+}
+
+// Demodulator SNR floor per SF (SX1276 datasheet), dB.
+static inline double sim_snr_floor_db(int sf)
+{
+    return -20.0 + 2.5 * (12 - sf);
+}
+
+static inline double sim_airtime_s(int sf, size_t phy_len)
+{
+    double tsym = (double)(1U << sf) / SIM_BW_HZ;
+    int de = (sf >= 11) ? 1 : 0;
+    double num = 8.0 * (double)phy_len - 4.0 * sf + 28.0 + 16.0;
+    double symbols = ceil(num / (4.0 * (sf - 2 * de))) * 5.0;
+    if (symbols < 0.0) {
+        symbols = 0.0;
+    }
+    return (SIM_PREAMBLE_SYMBOLS + 4.25 + 8.0 + symbols) * tsym;
+}
+
+// Okumura-Hata urban, 868 MHz, gateway at 30 m, device at 1.5 m.
+static inline double sim_path_loss_db(double dist_km)
+{
+    if (dist_km < 0.05) {
+        dist_km = 0.05;
+    }
+    return 126.1 + 35.2 * log10(dist_km);
+}
+
+// Channels 0-4 (867.1-867.9 MHz) are in band G, 5-7 (868.1-868.5 MHz) in
+// band G1; each band has its own 1 % duty cycle.
+static inline int sim_channel_band(int channel)
+{
+    return (channel < 5) ? 0 : 1;
+}
+
+typedef enum {
+    SIM_RX_OK = 0,
+    SIM_RX_WEAK,         // below the demodulator floor
+    SIM_RX_COLLISION,
+    SIM_RX_NO_PATH,      // all demodulators busy
+    SIM_RX_GW_TX         // gateway sending a downlink
+} sim_rx_result_t;
+
+typedef struct {
+    double start;
+    double end;
+    double rssi_dbm;
+    int channel;
+    int sf;
+    size_t id;
+    sim_rx_result_t result;
+} sim_rx_t;
+
+typedef struct {
+    double start;
+    double end;
+} sim_tx_t;
+
+// Frames on air at the gateway. begin() decides demodulator allocation and
+// marks collisions both ways; the final result is read at the frame's end.
+// Downlinks are committed at their RX window, possibly a little ahead.
+typedef struct {
+    std::vector<sim_rx_t> active;
+    std::vector<sim_tx_t> tx;
+    double airtime_s[SIM_CHANNELS];
+    double band_free[SIM_GATEWAY_BANDS];
+    double tx_airtime_s;
+} sim_gateway_t;
+
+static inline bool sim_gateway_transmitting(const sim_gateway_t *gw, double start, double end)
+{
+    for (const sim_tx_t &tx : gw->tx) {
+        if (start < tx.end && tx.start < end) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool sim_destroys(const sim_rx_t &victim, const sim_rx_t &other)
+{
+    if (victim.channel != other.channel) {
+        return false;
+    }
+    if (victim.sf == other.sf) {
+        return victim.rssi_dbm - other.rssi_dbm < SIM_CAPTURE_DB;
+    }
+    return other.rssi_dbm - victim.rssi_dbm > SIM_SF_REJECTION_DB;
+}
+
+static inline void sim_gateway_begin(sim_gateway_t *gw, sim_rx_t rx)
+{
+    for (size_t i = 0; i < gw->tx.size();) {
+        if (gw->tx[i].end <= rx.start) {
+            gw->tx[i] = gw->tx.back();
+            gw->tx.pop_back();
+        } else {
+            ++i;
+        }
+    }
+    double snr = rx.rssi_dbm - SIM_NOISE_FLOOR_DBM;
+    rx.result = SIM_RX_OK;
+    size_t paths = 0U;
+    for (sim_rx_t &other : gw->active) {
+        if (other.result != SIM_RX_WEAK && other.result != SIM_RX_NO_PATH) {
+            paths++;
+        }
+    }
+    if (snr < sim_snr_floor_db(rx.sf)) {
+        rx.result = SIM_RX_WEAK;
+    } else if (sim_gateway_transmitting(gw, rx.start, rx.end)) {
+        rx.result = SIM_RX_GW_TX;
+    } else if (paths >= SIM_GATEWAY_PATHS) {
+        rx.result = SIM_RX_NO_PATH;
+    }
+    for (sim_rx_t &other : gw->active) {
+        if (rx.result == SIM_RX_OK && sim_destroys(rx, other)) {
+            rx.result = SIM_RX_COLLISION;
+        }
+        if (other.result == SIM_RX_OK && sim_destroys(other, rx)) {
+            other.result = SIM_RX_COLLISION;
+        }
+    }
+    gw->airtime_s[rx.channel] += rx.end - rx.start;
+    gw->active.push_back(rx);
+}
+
+static inline sim_rx_result_t sim_gateway_end(sim_gateway_t *gw, size_t id)
+{
+    for (size_t i = 0; i < gw->active.size(); ++i) {
+        if (gw->active[i].id == id) {
+            sim_rx_result_t result = gw->active[i].result;
+            gw->active[i] = gw->active.back();
+            gw->active.pop_back();
+            return result;
+        }
+    }
+    return SIM_RX_WEAK;
+}
+
+// Sends a downlink in [start, start + airtime) on band if the gateway is not
+// already sending then and the band is out of its duty-cycle off time.
+// Uplinks on air during it are lost. Returns false if it cannot go out.
+static inline bool sim_gateway_downlink(sim_gateway_t *gw, int band, double start, double airtime, int duty_cycle)
+{
+    double end = start + airtime;
+    if (gw->band_free[band] > start || sim_gateway_transmitting(gw, start, end)) {
+        return false;
+    }
+    gw->tx.push_back(sim_tx_t{start, end});
+    gw->band_free[band] = start + airtime * duty_cycle;
+    gw->tx_airtime_s += airtime;
+    for (sim_rx_t &rx : gw->active) {
+        if (rx.result == SIM_RX_OK && rx.end > start) {
+            rx.result = SIM_RX_GW_TX;
+        }
+    }
+    return true;
+}
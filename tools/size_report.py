@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""Static RAM and flash use per module of a firmware ELF.
+
+    python3 tools/size_report.py BUILD/DISCO_L072CZ_LRWAN1/GCC_ARM/uplink-lorawan.elf [--su DIR]
+
+Symbols are attributed to the source file they are declared in (from the
+debug info, via nm -l): one row per bridge source (main.cpp, *.h at the repo
+root), one per mbed-os component, the rest under "other". Inlined code is
+counted in the function it was inlined into. With --su, the largest stack
+frame per module is added from GCC -fstack-usage output (.su files).
+"""
+
+import argparse
+import collections
+import os
+import re
+import subprocess
+import sys
+
+FLASH_TYPES = set("TtRrVvWw")
+DATA_TYPES = set("Dd")
+BSS_TYPES = set("BbSs")
+
+
+def module_of(path, repo_root):
+    if not path:
+        return "other"
+    path = os.path.normpath(path)
+    rel = os.path.relpath(path, repo_root) if os.path.isabs(path) else path
+    parts = rel.split(os.sep)
+    if parts[0] == "mbed-os":
+        return "/".join(parts[:2]) if len(parts) > 2 else "mbed-os"
+    if parts[0] == ".." or os.path.isabs(rel):
+        return "other"
+    if len(parts) == 1:
+        return parts[0]
+    return parts[0] + "/"
+
+
+def read_symbols(nm, elf):
+    out = subprocess.run([nm, "-S", "-C", "-l", "--defined-only", elf],
+                         check=True, capture_output=True, text=True).stdout
+    line_re = re.compile(r"^([0-9a-fA-F]+) ([0-9a-fA-F]+) (\w) (.*?)(?:\t(.*):\d+)?$")
+    for line in out.splitlines():
+        m = line_re.match(line)
+        if m:
+            yield int(m.group(2), 16), m.group(3), m.group(4), m.group(5)
+
+
+def read_stack_usage(su_dir, repo_root):
+    frames = collections.defaultdict(int)
+    for root, _, files in os.walk(su_dir):
+        for name in files:
+            if not name.endswith(".su"):
+                continue
+            with open(os.path.join(root, name)) as f:
+                for line in f:
+                    fields = line.rstrip("\n").split("\t")
+                    if len(fields) < 2:
+                        continue
+                    path = fields[0].split(":")[0]
+                    module = module_of(path, repo_root)
+                    frames[module] = max(frames[module], int(fields[1]))
+    return frames
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf")
+    parser.add_argument("--nm", default="arm-none-eabi-nm")
+    parser.add_argument("--su", help="directory searched for GCC .su files")
+    parser.add_argument("--root", default=os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+    args = parser.parse_args()
+
+    rows = collections.defaultdict(lambda: [0, 0, 0])  # flash, data, bss
+    for size, kind, _, path in read_symbols(args.nm, args.elf):
+        row = rows[module_of(path, args.root)]
+        if kind in FLASH_TYPES:
+            row[0] += size
+        elif kind in DATA_TYPES:
+            row[0] += size  # initial values are stored in flash
+            row[1] += size
+        elif kind in BSS_TYPES:
+            row[2] += size
+
+    frames = read_stack_usage(args.su, args.root) if args.su else {}
+
+    header = "%-32s %8s %8s %8s" % ("module", "flash", "data", "bss")
+    if frames:
+        header += " %9s" % "max_frame"
+    print(header)
+    total = [0, 0, 0]
+    for module, row in sorted(rows.items(), key=lambda kv: -(kv[1][0] + kv[1][1] + kv[1][2])):
+        line = "%-32s %8d %8d %8d" % (module, row[0], row[1], row[2])
+        if frames:
+            line += " %9s" % (frames[module] if module in frames else "-")
+        print(line)
+        total = [t + v for t, v in zip(total, row)]
+    print("%-32s %8d %8d %8d" % ("total", total[0], total[1], total[2]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,188 @@
+// Streams FPort 15 uplink payloads from a file or stdin and writes them as
+// CSV or columnar binary blocks (see uplink_decoder.h).
+//
+//   uplink_decode [--in bin|hex] [--out csv|bin] [file]
+//
+// --in bin: concatenated 16-byte payloads (default)
+// --in hex: one payload per line as hex, e.g. an export of frm_payload
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "uplink_decoder.h"
+
+namespace {
+
+constexpr size_t HEX_CHUNK = 1U << 16;
+constexpr size_t HEX_LINE_MAX = 256U;
+
+uplink_block_t block;
+uint8_t raw[UPLINK_BLOCK_RECORDS * UART_V1_PAYLOAD_LEN];
+char csv_out[UPLINK_BLOCK_RECORDS * UPLINK_CSV_MAX_ROW];
+uint8_t bin_out[UPLINK_BIN_MAX_BLOCK];
+char hex_in[HEX_CHUNK];
+
+struct decode_stats_t {
+    unsigned long long records;
+    unsigned long long bad_lines;
+    unsigned long long bad_version;
+};
+
+decode_stats_t stats = {};
+bool out_bin = false;
+
+void emit_block(size_t n)
+{
+    uplink_decode(raw, n, &block);
+    for (size_t i = 0; i < n; ++i) {
+        if (block.ver[i] != UART_V1_VERSION) {
+            stats.bad_version++;
+        }
+    }
+    stats.records += n;
+
+    if (out_bin) {
+        size_t len = uplink_format_bin(&block, bin_out);
+        fwrite(bin_out, 1, len, stdout);
+    } else {
+        size_t len = uplink_format_csv(&block, 0U, n, csv_out);
+        fwrite(csv_out, 1, len, stdout);
+    }
+}
+
+void run_bin(FILE *in)
+{
+    size_t have = 0U;
+    while (true) {
+        size_t got = fread(raw + have, 1, sizeof(raw) - have, in);
+        have += got;
+        size_t n = have / UART_V1_PAYLOAD_LEN;
+        if (got == 0U || have == sizeof(raw)) {
+            if (n != 0U) {
+                emit_block(n);
+            }
+            size_t rest = have - n * UART_V1_PAYLOAD_LEN;
+            memmove(raw, raw + n * UART_V1_PAYLOAD_LEN, rest);
+            have = rest;
+        }
+        if (got == 0U) {
+            if (have != 0U) {
+                fprintf(stderr, "trailing %zu bytes ignored\n", have);
+            }
+            return;
+        }
+    }
+}
+
+struct hex_reader_t {
+    char line[HEX_LINE_MAX];
+    size_t line_len;
+    bool line_overflow;
+    size_t n;
+};
+
+void hex_end_line(hex_reader_t &r)
+{
+    if (r.line_len != 0U) {
+        if (!r.line_overflow && uplink_parse_hex(r.line, r.line_len, &raw[r.n * UART_V1_PAYLOAD_LEN])) {
+            if (++r.n == UPLINK_BLOCK_RECORDS) {
+                emit_block(r.n);
+                r.n = 0U;
+            }
+        } else {
+            stats.bad_lines++;
+        }
+    }
+    r.line_len = 0U;
+    r.line_overflow = false;
+}
+
+void run_hex(FILE *in)
+{
+    static hex_reader_t r;
+    size_t got = 0U;
+    while ((got = fread(hex_in, 1, sizeof(hex_in), in)) != 0U) {
+        for (size_t i = 0; i < got; ++i) {
+            char c = hex_in[i];
+            if (c == '\n') {
+                hex_end_line(r);
+            } else if (r.line_len < sizeof(r.line)) {
+                r.line[r.line_len++] = c;
+            } else {
+                r.line_overflow = true;
+            }
+        }
+    }
+    hex_end_line(r);
+    if (r.n != 0U) {
+        emit_block(r.n);
+    }
+}
+
+int usage()
+{
+    fprintf(stderr, "usage: uplink_decode [--in bin|hex] [--out csv|bin] [file]\n");
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    bool in_hex = false;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--in") == 0 && i + 1 < argc) {
+            const char *v = argv[++i];
+            if (strcmp(v, "hex") == 0) {
+                in_hex = true;
+            } else if (strcmp(v, "bin") != 0) {
+                return usage();
+            }
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            const char *v = argv[++i];
+            if (strcmp(v, "bin") == 0) {
+                out_bin = true;
+            } else if (strcmp(v, "csv") != 0) {
+                return usage();
+            }
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            return usage();
+        } else {
+            path = argv[i];
+        }
+    }
+
+    FILE *in = stdin;
+    if (path != nullptr && strcmp(path, "-") != 0) {
+        in = fopen(path, "rb");
+        if (in == nullptr) {
+            perror(path);
+            return 1;
+        }
+    }
+
+    static char out_buf[1U << 20];
+    setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+    if (!out_bin) {
+        fputs(UPLINK_CSV_HEADER, stdout);
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    if (in_hex) {
+        run_hex(in);
+    } else {
+        run_bin(in);
+    }
+    fflush(stdout);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    fprintf(stderr, "records=%llu bad_lines=%llu bad_version=%llu %.3fs %.0f rec/s\n",
+            stats.records, stats.bad_lines, stats.bad_version, secs,
+            (secs > 0.0) ? (double)stats.records / secs : 0.0);
+    return 0;
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+// Batch decoder for FPort 15 uplinks (raw vision_uart_payload_v1_t), shared
+// with the firmware through protocol_uart_v1.h. Records are decoded block by
+// block into fixed column arrays; nothing is allocated.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+#include "protocol_uart_v1.h"
+
+#define UPLINK_BLOCK_RECORDS      4096U
+
+typedef struct {
+    size_t count;
+    uint8_t ver[UPLINK_BLOCK_RECORDS];
+    uint8_t msg_type[UPLINK_BLOCK_RECORDS];
+    uint8_t node_id[UPLINK_BLOCK_RECORDS];
+    uint8_t flags[UPLINK_BLOCK_RECORDS];
+    uint8_t luma[UPLINK_BLOCK_RECORDS];
+    uint8_t occupied[UPLINK_BLOCK_RECORDS];
+    uint8_t stable_count[UPLINK_BLOCK_RECORDS];
+    uint8_t raw_count[UPLINK_BLOCK_RECORDS];
+    uint32_t counter[UPLINK_BLOCK_RECORDS];
+    uint32_t uptime_s[UPLINK_BLOCK_RECORDS];
+} uplink_block_t;
+
+// Reference path, one record at a time through deserialize_payload_v1().
+static inline void uplink_decode_range(const uint8_t *src, size_t first, size_t n, uplink_block_t *out)
+{
+    for (size_t i = first; i < n; ++i) {
+        vision_uart_payload_v1_t p;
+        deserialize_payload_v1(&p, &src[i * UART_V1_PAYLOAD_LEN]);
+        out->ver[i] = p.ver;
+        out->msg_type[i] = p.msg_type;
+        out->node_id[i] = p.node_id;
+        out->flags[i] = p.flags;
+        out->luma[i] = p.luma;
+        out->occupied[i] = p.occupied;
+        out->stable_count[i] = p.stable_count;
+        out->raw_count[i] = p.raw_count;
+        out->counter[i] = p.counter;
+        out->uptime_s[i] = p.uptime_s;
+    }
+}
+
+static inline void uplink_decode_scalar(const uint8_t *src, size_t n, uplink_block_t *out)
+{
+    uplink_decode_range(src, 0U, n, out);
+    out->count = n;
+}
+
+#if defined(__SSSE3__)
+// Four records per iteration: one byte shuffle per record swaps counter and
+// uptime_s to host order, then unpacks transpose the 4x8 byte fields and the
+// 4x2 words into columns.
+static inline void uplink_decode_ssse3(const uint8_t *src, size_t n, uplink_block_t *out)
+{
+    const __m128i swap = _mm_setr_epi8(11, 10, 9, 8, 15, 14, 13, 12, 0, 1, 2, 3, 4, 5, 6, 7);
+    const __m128i interleave = _mm_setr_epi8(0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15);
+    uint8_t *const bytes[8] = {
+        out->ver, out->msg_type, out->node_id, out->flags,
+        out->luma, out->occupied, out->stable_count, out->raw_count
+    };
+
+    const size_t simd_n = n & ~(size_t)3U;
+    for (size_t i = 0; i < simd_n; i += 4U) {
+        const uint8_t *r = &src[i * UART_V1_PAYLOAD_LEN];
+        __m128i a0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(r + 0)), swap);
+        __m128i a1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(r + 16)), swap);
+        __m128i a2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(r + 32)), swap);
+        __m128i a3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(r + 48)), swap);
+
+        // a_k = [counter, uptime_s, bytes 0-3, bytes 4-7]
+        __m128i w01 = _mm_unpacklo_epi32(a0, a1);
+        __m128i w23 = _mm_unpacklo_epi32(a2, a3);
+        _mm_storeu_si128((__m128i *)&out->counter[i], _mm_unpacklo_epi64(w01, w23));
+        _mm_storeu_si128((__m128i *)&out->uptime_s[i], _mm_unpackhi_epi64(w01, w23));
+
+        __m128i b01 = _mm_shuffle_epi8(_mm_unpackhi_epi64(a0, a1), interleave);
+        __m128i b23 = _mm_shuffle_epi8(_mm_unpackhi_epi64(a2, a3), interleave);
+        __m128i lo = _mm_unpacklo_epi16(b01, b23);
+        __m128i hi = _mm_unpackhi_epi16(b01, b23);
+        uint32_t col[8];
+        _mm_storeu_si128((__m128i *)&col[0], lo);
+        _mm_storeu_si128((__m128i *)&col[4], hi);
+        for (size_t f = 0; f < 8U; ++f) {
+            memcpy(&bytes[f][i], &col[f], 4U);
+        }
+    }
+
+    uplink_decode_range(src, simd_n, n, out);
+    out->count = n;
+}
+#endif
+
+// Decodes n <= UPLINK_BLOCK_RECORDS consecutive 16-byte payloads.
+static inline void uplink_decode(const uint8_t *src, size_t n, uplink_block_t *out)
+{
+#if defined(__SSSE3__)
+    uplink_decode_ssse3(src, n, out);
+#else
+    uplink_decode_scalar(src, n, out);
+#endif
+}
+
+static inline int uplink_hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Parses one line of hex (whitespace ignored) into a 16-byte payload.
+static inline bool uplink_parse_hex(const char *line, size_t len, uint8_t out[UART_V1_PAYLOAD_LEN])
+{
+    size_t nibbles = 0;
+    for (size_t i = 0; i < len; ++i) {
+        char c = line[i];
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            continue;
+        }
+        int v = uplink_hex_nibble(c);
+        if (v < 0 || nibbles >= 2U * UART_V1_PAYLOAD_LEN) {
+            return false;
+        }
+        if ((nibbles & 1U) == 0U) {
+            out[nibbles / 2U] = (uint8_t)(v << 4);
+        } else {
+            out[nibbles / 2U] |= (uint8_t)v;
+        }
+        nibbles++;
+    }
+    return nibbles == 2U * UART_V1_PAYLOAD_LEN;
+}
+
+static inline char *uplink_put_u8(char *p, uint8_t v)
+{
+    if (v >= 100U) {
+        *p++ = (char)('0' + v / 100U);
+        v = (uint8_t)(v % 100U);
+        *p++ = (char)('0' + v / 10U);
+    } else if (v >= 10U) {
+        *p++ = (char)('0' + v / 10U);
+    }
+    *p++ = (char)('0' + v % 10U);
+    return p;
+}
+
+static inline char *uplink_put_u32(char *p, uint32_t v)
+{
+    char tmp[10];
+    size_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + (v % 10U));
+        v /= 10U;
+    } while (v != 0U);
+    while (n != 0U) {
+        *p++ = tmp[--n];
+    }
+    return p;
+}
+
+#define UPLINK_CSV_HEADER         "ver,msg_type,node_id,flags,luma,occupied,stable_count,raw_count,counter,uptime_s\n"
+#define UPLINK_CSV_MAX_ROW        64U
+
+// Formats rows [first, first + n) of a block; out needs n * UPLINK_CSV_MAX_ROW bytes.
+static inline size_t uplink_format_csv(const uplink_block_t *b, size_t first, size_t n, char *out)
+{
+    char *p = out;
+    for (size_t i = first; i < first + n; ++i) {
+        p = uplink_put_u8(p, b->ver[i]);
+        *p++ = ',';
+        p = uplink_put_u8(p, b->msg_type[i]);
+        *p++ = ',';
+        p = uplink_put_u8(p, b->node_id[i]);
+        *p++ = ',';
+        p = uplink_put_u8(p, b->flags[i]);
+        *p++ = ',';
+        p = uplink_put_u8(p, b->luma[i]);
+        *p++ = ',';
+        p = uplink_put_u8(p, b->occupied[i]);
+        *p++ = ',';
+        p = uplink_put_u8(p, b->stable_count[i]);
+        *p++ = ',';
+        p = uplink_put_u8(p, b->raw_count[i]);
+        *p++ = ',';
+        p = uplink_put_u32(p, b->counter[i]);
+        *p++ = ',';
+        p = uplink_put_u32(p, b->uptime_s[i]);
+        *p++ = '\n';
+    }
+    return (size_t)(p - out);
+}
+
+// Columnar binary block: "UPL1" | u32 count | 8 byte columns | counter[] | uptime_s[]
+// (integers little-endian).
+#define UPLINK_BIN_MAGIC          "UPL1"
+
+static inline size_t uplink_format_bin(const uplink_block_t *b, uint8_t *out)
+{
+    size_t n = b->count;
+    uint8_t *p = out;
+    memcpy(p, UPLINK_BIN_MAGIC, 4U);
+    p += 4;
+    for (size_t k = 0; k < 4U; ++k) {
+        *p++ = (uint8_t)(n >> (8U * k));
+    }
+    const uint8_t *const bytes[8] = {
+        b->ver, b->msg_type, b->node_id, b->flags,
+        b->luma, b->occupied, b->stable_count, b->raw_count
+    };
+    for (size_t f = 0; f < 8U; ++f) {
+        memcpy(p, bytes[f], n);
+        p += n;
+    }
+    const uint32_t *const words[2] = { b->counter, b->uptime_s };
+    for (size_t f = 0; f < 2U; ++f) {
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t v = words[f][i];
+            p[0] = (uint8_t)v;
+            p[1] = (uint8_t)(v >> 8);
+            p[2] = (uint8_t)(v >> 16);
+            p[3] = (uint8_t)(v >> 24);
+            p += 4;
+        }
+    }
+    return (size_t)(p - out);
+}
+
+#define UPLINK_BIN_MAX_BLOCK      (8U + UPLINK_BLOCK_RECORDS * 16U)
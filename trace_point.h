@@ -0,0 +1,147 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Compile-time tracepoints on hot paths: TRACE_BEGIN/TRACE_END around a
+// block record count and min/avg/max duration per tracepoint. Enabled by
+// "tracepoints" in mbed_app.json on target, BRIDGE_TRACEPOINTS on host;
+// otherwise the macros expand to nothing and no table is kept.
+//
+// Target durations are core clock cycles from SysTick (the Cortex-M0+ has no
+// DWT cycle counter). With MBED_TICKLESS the RTOS does not use SysTick, so it
+// is run free over 24 bits (~0.5 s at 32 MHz); otherwise it keeps the RTOS
+// reload value and spans are only valid up to one tick. Host durations are
+// nanoseconds from std::chrono::steady_clock.
+#if defined(MBED_CONF_APP_TRACEPOINTS)
+#define TRACE_POINTS_ENABLED      MBED_CONF_APP_TRACEPOINTS
+#elif defined(BRIDGE_TRACEPOINTS)
+#define TRACE_POINTS_ENABLED      BRIDGE_TRACEPOINTS
+#else
+#define TRACE_POINTS_ENABLED      0
+#endif
+
+typedef enum {
+    TRACE_UART_BYTE = 0,
+    TRACE_CRC16,
+    TRACE_PC_LOG,
+    TRACE_LORAWAN_SEND,
+    TRACE_ID_COUNT
+} trace_id_t;
+
+#if TRACE_POINTS_ENABLED
+
+#if defined(__MBED__)
+#include "mbed.h"
+#define TRACE_UNIT                "cyc"
+#elif defined(__cplusplus)
+#include <chrono>
+#define TRACE_UNIT                "ns"
+#else
+#error "host tracepoints need C++ (std::chrono)"
+#endif
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+} trace_stat_t;
+
+static inline const char *trace_name(trace_id_t id)
+{
+    switch (id) {
+        case TRACE_UART_BYTE:    return "handle_uart_byte";
+        case TRACE_CRC16:        return "uart_v1_crc16_ccitt";
+        case TRACE_PC_LOG:       return "pc_log";
+        case TRACE_LORAWAN_SEND: return "lorawan.send";
+        default:                 return "?";
+    }
+}
+
+// One table per translation unit; the firmware is a single one.
+static inline trace_stat_t *trace_stats(void)
+{
+    static trace_stat_t stats[TRACE_ID_COUNT];
+    return stats;
+}
+
+static inline void trace_reset(void)
+{
+    trace_stat_t *s = trace_stats();
+    for (size_t i = 0; i < TRACE_ID_COUNT; ++i) {
+        s[i].count = 0U;
+        s[i].min = UINT32_MAX;
+        s[i].max = 0U;
+        s[i].total = 0U;
+    }
+}
+
+#if defined(__MBED__)
+static inline void trace_init(void)
+{
+#if defined(MBED_TICKLESS)
+    SysTick->LOAD = SysTick_LOAD_RELOAD_Msk;
+    SysTick->VAL = 0U;
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+#endif
+    trace_reset();
+}
+
+static inline uint32_t trace_now(void)
+{
+    return SysTick->VAL;
+}
+
+// SysTick counts down and wraps at LOAD + 1.
+static inline uint32_t trace_elapsed(uint32_t start)
+{
+    uint32_t now = SysTick->VAL;
+    return (start >= now) ? (start - now) : (start + SysTick->LOAD + 1U - now);
+}
+#else
+static inline void trace_init(void)
+{
+    trace_reset();
+}
+
+static inline uint32_t trace_now(void)
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline uint32_t trace_elapsed(uint32_t start)
+{
+    return trace_now() - start;
+}
+#endif
+
+static inline void trace_record(trace_id_t id, uint32_t ticks)
+{
+    trace_stat_t *s = &trace_stats()[id];
+    s->count++;
+    s->total += ticks;
+    if (ticks < s->min) {
+        s->min = ticks;
+    }
+    if (ticks > s->max) {
+        s->max = ticks;
+    }
+}
+
+static inline uint32_t trace_avg(const trace_stat_t *s)
+{
+    return (s->count != 0U) ? (uint32_t)(s->total / s->count) : 0U;
+}
+
+#define TRACE_BEGIN(id)           uint32_t trace_start_##id = trace_now()
+#define TRACE_END(id)             trace_record((id), trace_elapsed(trace_start_##id))
+
+#else
+
+#define TRACE_BEGIN(id)           do { } while (0)
+#define TRACE_END(id)             do { } while (0)
+
+#endif  // TRACE_POINTS_ENABLED
@@ -17,3 +17,12 @@ static uint8_t TTN_APP_KEY[16] = {
     0x00, 0x00, 0x00, 0x00,
     0x00, 0x00, 0x00, 0x00
 };
+
+// Key authenticating downlink commands on FPort 16 (AES-CMAC). Kept apart from
+// the LoRaWAN keys so the application backend can sign commands on its own.
+static uint8_t TTN_CMD_KEY[16] = {
+    0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "protocol_uart_v1.h"
+#include "trace_point.h"
+
+// Byte-at-a-time decoder for the UART v1 framing. All state lives in the
+// context, so each serial link gets its own parser.
+typedef enum {
+    UART_V1_PARSER_WAIT_SOF1 = 0,
+    UART_V1_PARSER_WAIT_SOF2,
+    UART_V1_PARSER_WAIT_LEN,
+    UART_V1_PARSER_READ_PAYLOAD,
+    UART_V1_PARSER_READ_CRC
+} uart_v1_parser_state_t;
+
+typedef enum {
+    UART_V1_PARSE_MORE = 0,
+    UART_V1_PARSE_FRAME,
+    UART_V1_PARSE_DROP_LEN,
+    UART_V1_PARSE_DROP_CRC
+} uart_v1_parse_result_t;
+
+typedef struct {
+    uart_v1_parser_state_t state;
+    uint8_t len;
+    uint8_t payload[UART_V1_PAYLOAD_LEN];
+    uint8_t payload_index;
+    uint8_t crc_rx[2];
+    uint8_t crc_index;
+} uart_v1_parser_t;
+
+static inline void uart_v1_parser_reset(uart_v1_parser_t *p)
+{
+    p->state = UART_V1_PARSER_WAIT_SOF1;
+    p->len = 0U;
+    p->payload_index = 0U;
+    p->crc_index = 0U;
+}
+
+// On UART_V1_PARSE_FRAME the payload is valid in p->payload until the next
+// call.
+static inline uart_v1_parse_result_t uart_v1_parser_feed(uart_v1_parser_t *p, uint8_t byte)
+{
+    switch (p->state) {
+        case UART_V1_PARSER_WAIT_SOF1:
+            if (byte == UART_V1_SOF1) {
+                p->state = UART_V1_PARSER_WAIT_SOF2;
+            }
+            break;
+
+        case UART_V1_PARSER_WAIT_SOF2:
+            if (byte == UART_V1_SOF2) {
+                p->state = UART_V1_PARSER_WAIT_LEN;
+            } else if (byte != UART_V1_SOF1) {
+                p->state = UART_V1_PARSER_WAIT_SOF1;
+            }
+            break;
+
+        case UART_V1_PARSER_WAIT_LEN:
+            p->len = byte;
+            if (p->len != UART_V1_PAYLOAD_LEN) {
+                p->state = (byte == UART_V1_SOF1) ? UART_V1_PARSER_WAIT_SOF2 : UART_V1_PARSER_WAIT_SOF1;
+                return UART_V1_PARSE_DROP_LEN;
+            }
+            p->payload_index = 0U;
+            p->state = UART_V1_PARSER_READ_PAYLOAD;
+            break;
+
+        case UART_V1_PARSER_READ_PAYLOAD:
+            p->payload[p->payload_index++] = byte;
+            if (p->payload_index >= UART_V1_PAYLOAD_LEN) {
+                p->crc_index = 0U;
+                p->state = UART_V1_PARSER_READ_CRC;
+            }
+            break;
+
+        case UART_V1_PARSER_READ_CRC:
+            p->crc_rx[p->crc_index++] = byte;
+            if (p->crc_index >= 2U) {
+                uint8_t crc_input[1U + UART_V1_PAYLOAD_LEN];
+                crc_input[0] = p->len;
+                memcpy(&crc_input[1], p->payload, UART_V1_PAYLOAD_LEN);
+                TRACE_BEGIN(TRACE_CRC16);
+                uint16_t crc_calc = uart_v1_crc16_ccitt(crc_input, sizeof(crc_input));
+                TRACE_END(TRACE_CRC16);
+                uint16_t crc_recv = ((uint16_t)p->crc_rx[0] << 8) | (uint16_t)p->crc_rx[1];
+                uart_v1_parser_reset(p);
+                return (crc_calc == crc_recv) ? UART_V1_PARSE_FRAME : UART_V1_PARSE_DROP_CRC;
+            }
+            break;
+    }
+    return UART_V1_PARSE_MORE;
+}